@@ -2,11 +2,146 @@
 #include <vector>
 #include <random>   // For random number generation
 #include <chrono>   // For seeding the random number generator
+#include <algorithm> // For std::max and std::min
+#include <cstdint>  // For the packed 64-bit map words
+#include <cstring>
+#include <type_traits>
+#include <new>      // For aligned operator new
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>   // For the tiled parallel cellular automata
+#include <string>
+#include <unordered_map>
+#include <array>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <cmath>
+#include <tuple>
+#include <cerrno>
+#include <cstdlib>
 
 // Define Map as a vector of vectors of integers.
 // You can change 'int' to whatever type best represents your cells (e.g., char, bool).
 using Map = std::vector<std::vector<int>>;
 
+/**
+ * @brief Minimal allocator returning 64-byte (cache line) aligned storage.
+ */
+template <typename T>
+struct AlignedAllocator {
+    using value_type = T;
+    static constexpr std::size_t alignment = 64;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{alignment}));
+    }
+    void deallocate(T* p, std::size_t) {
+        ::operator delete(p, std::align_val_t{alignment});
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+/**
+ * @brief Contiguous, 64-byte aligned, row-strided 2D grid.
+ * All rows live in one allocation; each row starts on a cache line because
+ * the stride is rounded up to a whole number of 64-byte lines. grid[i][j]
+ * works like on a Map, so the templated map functions accept a Grid as-is.
+ */
+template <typename T>
+class Grid {
+public:
+    /**
+     * @brief Non-owning view of one row (pointer + width).
+     */
+    template <typename U>
+    class BasicRowView {
+    public:
+        BasicRowView(U* data, int size) : data_(data), size_(size) {}
+        U& operator[](int j) const { return data_[j]; }
+        U* data() const { return data_; }
+        U* begin() const { return data_; }
+        U* end() const { return data_ + size_; }
+        int size() const { return size_; }
+
+    private:
+        U* data_;
+        int size_;
+    };
+    using RowView = BasicRowView<T>;
+    using ConstRowView = BasicRowView<const T>;
+
+    Grid() = default;
+    Grid(int W, int H, const T& value = T())
+        : W_(W), H_(H), stride_(paddedStride(W)),
+          cells_(static_cast<std::size_t>(H) * paddedStride(W), value) {}
+
+    int width() const { return W_; }
+    int height() const { return H_; }
+    int stride() const { return stride_; }
+
+    T* data() { return cells_.data(); }
+    const T* data() const { return cells_.data(); }
+
+    RowView operator[](int i) { return RowView(cells_.data() + static_cast<std::size_t>(i) * stride_, W_); }
+    ConstRowView operator[](int i) const { return ConstRowView(cells_.data() + static_cast<std::size_t>(i) * stride_, W_); }
+
+private:
+    static int paddedStride(int W) {
+        constexpr std::size_t line = AlignedAllocator<T>::alignment;
+        if (sizeof(T) > line || line % sizeof(T) != 0) {
+            return W;
+        }
+        const int perLine = static_cast<int>(line / sizeof(T));
+        return (W + perLine - 1) / perLine * perLine;
+    }
+
+    int W_ = 0;
+    int H_ = 0;
+    int stride_ = 0;
+    std::vector<T, AlignedAllocator<T>> cells_;
+};
+
+/**
+ * @brief Copies a Map into a contiguous Grid.
+ * @param map The map to copy.
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @return The grid holding the same cells.
+ */
+template <typename T = int>
+Grid<T> toGrid(const Map& map, int W, int H) {
+    Grid<T> grid(W, H);
+    for (int i = 0; i < H; ++i) {
+        std::copy(map[i].begin(), map[i].begin() + W, grid[i].begin());
+    }
+    return grid;
+}
+
+/**
+ * @brief Copies a Grid back into a Map.
+ * @param grid The grid to copy.
+ * @return The map holding the same cells.
+ */
+template <typename T>
+Map toMap(const Grid<T>& grid) {
+    Map map(grid.height(), std::vector<int>(grid.width(), 0));
+    for (int i = 0; i < grid.height(); ++i) {
+        std::copy(grid[i].begin(), grid[i].end(), map[i].begin());
+    }
+    return map;
+}
+
 /**
  * @brief Prints the map (matrix) to the console.
  * @param map The map to print.
@@ -17,46 +152,3256 @@ void printMap(const Map& map) {
         for (int cell : row) {
             std::cout << (cell == 1 ? "#" : " ") << " ";
         }
-        std::cout << std::endl;
+        std::cout << std::endl;
+    }
+    std::cout << "-------------------" << std::endl;
+}
+
+/**
+ * @brief Prints a grid to the console, same format as printMap(const Map&).
+ * @param grid The grid to print.
+ */
+template <typename T>
+void printMap(const Grid<T>& grid) {
+    std::cout << "--- Current Map ---" << std::endl;
+    for (int i = 0; i < grid.height(); ++i) {
+        for (const T& cell : grid[i]) {
+            std::cout << (cell == 1 ? "#" : " ") << " ";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "-------------------" << std::endl;
+}
+
+/**
+ * @brief Smallest neighbor count that turns a cell into 1.
+ * A cell becomes 1 when count / (2R+1)^2 > U; the division is evaluated here
+ * once with the same double arithmetic as cellularAutomata, so integer
+ * comparisons against the result give identical decisions.
+ * @param R Radius of the neighbor window.
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @return The minimum count, or (2R+1)^2 + 1 if no count can pass U.
+ */
+int minCountAbove(int R, double U) {
+    const int area = (2 * R + 1) * (2 * R + 1);
+    for (int count = 0; count <= area; ++count) {
+        if (static_cast<double>(count) / area > U) {
+            return count;
+        }
+    }
+    return area + 1;
+}
+
+/**
+ * @brief Cellular Automata rule applied to a rectangular region only.
+ * Cells in [rowBegin, rowEnd) x [colBegin, colEnd) of newMap are written from
+ * currentMap; the window is still clipped against the whole W x H map, so
+ * splitting a map into regions gives exactly the same result as one pass.
+ * @param currentMap The map in its current state.
+ * @param newMap Destination for the next generation (must not alias currentMap).
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @param rowBegin First row of the region.
+ * @param rowEnd One past the last row of the region.
+ * @param colBegin First column of the region.
+ * @param colEnd One past the last column of the region.
+ */
+template <typename MapT>
+void cellularAutomataRegion(const MapT& currentMap, MapT& newMap, int W, int H, int R, double U,
+                            int rowBegin, int rowEnd, int colBegin, int colEnd) {
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        for (int j = colBegin; j < colEnd; ++j) {
+            // Contar vecinos con valor 1 en la ventana de radio R
+            int countOnes = 0;
+            for (int di = -R; di <= R; ++di) {
+                for (int dj = -R; dj <= R; ++dj) {
+                    int ni = i + di;
+                    int nj = j + dj;
+                    if (ni >= 0 && ni < H && nj >= 0 && nj < W) {
+                        countOnes += currentMap[ni][nj];
+                    }
+                }
+            }
+            // Aplicar regla
+            double neighborRatio = static_cast<double>(countOnes) / ((2 * R + 1) * (2 * R + 1));
+            newMap[i][j] = (neighborRatio > U) ? 1 : 0;
+        }
+    }
+}
+
+/**
+ * @brief Cellular Automata step writing into a caller-owned buffer.
+ * Every cell of newMap is overwritten, so no copy or allocation is needed;
+ * newMap must already have the map's dimensions and must not alias currentMap.
+ * @param currentMap The map in its current state.
+ * @param newMap Destination for the next generation.
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ */
+template <typename MapT>
+void cellularAutomataInto(const MapT& currentMap, MapT& newMap, int W, int H, int R, double U) {
+    cellularAutomataRegion(currentMap, newMap, W, H, R, U, 0, H, 0, W);
+}
+
+/**
+ * @brief Cellular Automata rule over a region with the radius fixed at compile time.
+ * The (2R+1)^2 window loops have constant bounds and are fully unrolled, the
+ * interior columns skip the bounds checks, and the ratio test is replaced by
+ * an integer compare against a precomputed count threshold.
+ * @tparam R Radius of the neighbor window.
+ * @param threshold Minimum window count that yields 1 (see minCountAbove).
+ * Other parameters are as in cellularAutomataRegion.
+ */
+template <int R, typename MapT>
+void cellularAutomataRegionFixed(const MapT& currentMap, MapT& newMap, int W, int H, int threshold,
+                                 int rowBegin, int rowEnd, int colBegin, int colEnd) {
+    auto clippedCount = [&](int i, int j) {
+        int countOnes = 0;
+        for (int di = -R; di <= R; ++di) {
+            for (int dj = -R; dj <= R; ++dj) {
+                int ni = i + di;
+                int nj = j + dj;
+                if (ni >= 0 && ni < H && nj >= 0 && nj < W) {
+                    countOnes += currentMap[ni][nj];
+                }
+            }
+        }
+        return countOnes;
+    };
+
+    // Columnas cuya ventana cabe entera en el mapa
+    const int innerBegin = std::max(colBegin, R);
+    const int innerEnd = std::max(innerBegin, std::min(colEnd, W - R));
+
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        if (i < R || i + R >= H) {
+            for (int j = colBegin; j < colEnd; ++j) {
+                newMap[i][j] = (clippedCount(i, j) >= threshold) ? 1 : 0;
+            }
+            continue;
+        }
+        for (int j = colBegin; j < std::min(innerBegin, colEnd); ++j) {
+            newMap[i][j] = (clippedCount(i, j) >= threshold) ? 1 : 0;
+        }
+        for (int j = innerBegin; j < innerEnd; ++j) {
+            int countOnes = 0;
+            for (int di = -R; di <= R; ++di) {
+                const auto& row = currentMap[i + di];
+                for (int dj = -R; dj <= R; ++dj) {
+                    countOnes += row[j + dj];
+                }
+            }
+            newMap[i][j] = (countOnes >= threshold) ? 1 : 0;
+        }
+        for (int j = std::max(innerEnd, colBegin); j < colEnd; ++j) {
+            newMap[i][j] = (clippedCount(i, j) >= threshold) ? 1 : 0;
+        }
+    }
+}
+
+/**
+ * @brief cellularAutomataRegion using the compile-time radius kernels for R = 1..4.
+ * Other radii fall back to the generic cellularAutomataRegion.
+ */
+template <typename MapT>
+void cellularAutomataRegionSpecialized(const MapT& currentMap, MapT& newMap, int W, int H, int R, double U,
+                                       int rowBegin, int rowEnd, int colBegin, int colEnd) {
+    const int threshold = minCountAbove(R, U);
+    switch (R) {
+    case 1:
+        cellularAutomataRegionFixed<1>(currentMap, newMap, W, H, threshold, rowBegin, rowEnd, colBegin, colEnd);
+        break;
+    case 2:
+        cellularAutomataRegionFixed<2>(currentMap, newMap, W, H, threshold, rowBegin, rowEnd, colBegin, colEnd);
+        break;
+    case 3:
+        cellularAutomataRegionFixed<3>(currentMap, newMap, W, H, threshold, rowBegin, rowEnd, colBegin, colEnd);
+        break;
+    case 4:
+        cellularAutomataRegionFixed<4>(currentMap, newMap, W, H, threshold, rowBegin, rowEnd, colBegin, colEnd);
+        break;
+    default:
+        cellularAutomataRegion(currentMap, newMap, W, H, R, U, rowBegin, rowEnd, colBegin, colEnd);
+        break;
+    }
+}
+
+/**
+ * @brief cellularAutomataInto using the compile-time radius kernels for R = 1..4.
+ * Parameters are as in cellularAutomataInto.
+ */
+template <typename MapT>
+void cellularAutomataSpecialized(const MapT& currentMap, MapT& newMap, int W, int H, int R, double U) {
+    cellularAutomataRegionSpecialized(currentMap, newMap, W, H, R, U, 0, H, 0, W);
+}
+
+/**
+ * @brief Cellular Automata rule over a region whose windows lie entirely inside the map.
+ * Works for any R with no bounds checks: the caller guarantees
+ * R <= rowBegin, rowEnd <= H - R, R <= colBegin and colEnd <= W - R.
+ * @param threshold Minimum neighbor count for a 1 (see minCountAbove).
+ */
+template <typename MapT>
+void cellularAutomataRegionInterior(const MapT& currentMap, MapT& newMap, int R, int threshold,
+                                    int rowBegin, int rowEnd, int colBegin, int colEnd) {
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        auto&& out = newMap[i];
+        for (int j = colBegin; j < colEnd; ++j) {
+            int countOnes = 0;
+            for (int ni = i - R; ni <= i + R; ++ni) {
+                const auto& row = currentMap[ni];
+                for (int nj = j - R; nj <= j + R; ++nj) {
+                    countOnes += row[nj];
+                }
+            }
+            out[j] = (countOnes >= threshold) ? 1 : 0;
+        }
+    }
+}
+
+/**
+ * @brief How the neighbor window treats cells beyond the map edge.
+ */
+enum class BorderMode {
+    Clip,   // Fuera del mapa cuenta como 0 (comportamiento de cellularAutomata)
+    Wall,   // Fuera del mapa cuenta como 1 (muro constante)
+    Wrap,   // Toroidal: el mapa se repite
+    Mirror  // Reflejo en el borde: -1 -> 0, -2 -> 1, n -> n-1, ...
+};
+
+/**
+ * @brief Maps a possibly out-of-range coordinate into [0, n).
+ * @return The index to read, or -1 if the cell lies outside the map (Clip/Wall).
+ */
+int borderIndex(int k, int n, BorderMode mode) {
+    if (k >= 0 && k < n) {
+        return k;
+    }
+    switch (mode) {
+    case BorderMode::Wrap:
+        return ((k % n) + n) % n;
+    case BorderMode::Mirror: {
+        const int m = ((k % (2 * n)) + 2 * n) % (2 * n);
+        return (m < n) ? m : 2 * n - 1 - m;
+    }
+    default:
+        return -1;
+    }
+}
+
+/**
+ * @brief Cellular Automata step with an explicit border mode.
+ * Cells whose window lies inside the map are computed without bounds checks
+ * (the unrolled kernels of cellularAutomataRegionSpecialized for R = 1..4,
+ * cellularAutomataRegionInterior otherwise); only the R-wide frame
+ * along the edges goes through borderIndex, using per-row and per-column
+ * index tables built once per call.
+ * @param currentMap The map in its current state.
+ * @param newMap Destination for the next generation (must not alias currentMap).
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @param mode What lies beyond the map edges.
+ */
+template <typename MapT>
+void cellularAutomataBorder(const MapT& currentMap, MapT& newMap, int W, int H, int R, double U,
+                            BorderMode mode) {
+    if (W <= 0 || H <= 0) {
+        return;
+    }
+
+    // Interior: la ventana nunca sale del mapa
+    const int innerRowBegin = std::min(R, H);
+    const int innerRowEnd = std::max(innerRowBegin, H - R);
+    const int innerColBegin = std::min(R, W);
+    const int innerColEnd = std::max(innerColBegin, W - R);
+    const int threshold = minCountAbove(R, U);
+    if (R >= 1 && R <= 4) {
+        cellularAutomataRegionSpecialized(currentMap, newMap, W, H, R, U,
+                                          innerRowBegin, innerRowEnd, innerColBegin, innerColEnd);
+    } else {
+        cellularAutomataRegionInterior(currentMap, newMap, R, threshold,
+                                       innerRowBegin, innerRowEnd, innerColBegin, innerColEnd);
+    }
+
+    // Marco: índices precalculados para las coordenadas -R .. n + R - 1
+    std::vector<int> rowIndex(static_cast<std::size_t>(H) + 2 * R);
+    std::vector<int> colIndex(static_cast<std::size_t>(W) + 2 * R);
+    for (int k = -R; k < H + R; ++k) {
+        rowIndex[k + R] = borderIndex(k, H, mode);
+    }
+    for (int k = -R; k < W + R; ++k) {
+        colIndex[k + R] = borderIndex(k, W, mode);
+    }
+    const int outside = (mode == BorderMode::Wall) ? 1 : 0;
+
+    auto frameCell = [&](int i, int j) {
+        int countOnes = 0;
+        for (int di = -R; di <= R; ++di) {
+            const int ni = rowIndex[i + di + R];
+            for (int dj = -R; dj <= R; ++dj) {
+                const int nj = colIndex[j + dj + R];
+                countOnes += (ni < 0 || nj < 0) ? outside : currentMap[ni][nj];
+            }
+        }
+        newMap[i][j] = (countOnes >= threshold) ? 1 : 0;
+    };
+
+    for (int i = 0; i < H; ++i) {
+        if (i >= innerRowBegin && i < innerRowEnd) {
+            for (int j = 0; j < innerColBegin; ++j) {
+                frameCell(i, j);
+            }
+            for (int j = innerColEnd; j < W; ++j) {
+                frameCell(i, j);
+            }
+        } else {
+            for (int j = 0; j < W; ++j) {
+                frameCell(i, j);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Adds sign times the horizontal (2R+1)-window sums of one row into colCount.
+ * A running sum slides along the row, so each cell costs O(1) whatever R is.
+ */
+template <typename RowT>
+void addRowWindowSums(const RowT& row, int W, int R, int sign, std::vector<int>& colCount) {
+    int windowSum = 0;
+    for (int j = 0; j <= std::min(R, W - 1); ++j) {
+        windowSum += row[j];
+    }
+    for (int j = 0; j < W; ++j) {
+        colCount[j] += sign * windowSum;
+        if (j + R + 1 < W) {
+            windowSum += row[j + R + 1];
+        }
+        if (j - R >= 0) {
+            windowSum -= row[j - R];
+        }
+    }
+}
+
+/**
+ * @brief Separable sliding-window Cellular Automata over a range of rows.
+ * colCount[j] holds the (2R+1)x(2R+1) window count of the current row; moving
+ * down one row adds the horizontal window sums of the row entering the window
+ * and subtracts those of the row leaving it. Both passes are O(1) per cell and
+ * stream rows in order, with a single W-sized buffer of extra memory. Only
+ * rows rowBegin - R .. rowEnd + R - 1 of currentMap are read, which lets the
+ * caller pass a band of a larger map.
+ * @param currentMap The map in its current state (anything indexable as map[i][j]).
+ * @param newMap Destination for the next generation (must not alias currentMap).
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @param rowBegin First row to compute.
+ * @param rowEnd One past the last row to compute.
+ */
+template <typename SrcT, typename DstT>
+void cellularAutomataSlidingRows(const SrcT& currentMap, DstT& newMap, int W, int H, int R, double U,
+                                 int rowBegin, int rowEnd) {
+    if (W <= 0 || rowBegin >= rowEnd) {
+        return;
+    }
+    const int threshold = minCountAbove(R, U);
+    std::vector<int> colCount(W, 0);
+    for (int r = std::max(0, rowBegin - R); r <= std::min(H - 1, rowBegin + R); ++r) {
+        addRowWindowSums(currentMap[r], W, R, +1, colCount);
+    }
+
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        auto&& out = newMap[i];
+        for (int j = 0; j < W; ++j) {
+            out[j] = (colCount[j] >= threshold) ? 1 : 0;
+        }
+        // Desplazar la ventana vertical una fila hacia abajo
+        if (i + 1 < rowEnd) {
+            if (i + R + 1 < H) {
+                addRowWindowSums(currentMap[i + R + 1], W, R, +1, colCount);
+            }
+            if (i - R >= 0) {
+                addRowWindowSums(currentMap[i - R], W, R, -1, colCount);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Separable sliding-window Cellular Automata step over the whole map.
+ * Parameters are as in cellularAutomataInto.
+ */
+template <typename MapT>
+void cellularAutomataSliding(const MapT& currentMap, MapT& newMap, int W, int H, int R, double U) {
+    cellularAutomataSlidingRows(currentMap, newMap, W, H, R, U, 0, H);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PCG_POSIX 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Throws std::runtime_error with the current errno message.
+ */
+[[noreturn]] void throwSystemError(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/**
+ * @brief Owns a POSIX file descriptor.
+ */
+class FileHandle {
+public:
+    FileHandle(const std::string& path, int flags, mode_t mode = 0644) : fd_(::open(path.c_str(), flags, mode)) {
+        if (fd_ < 0) {
+            throwSystemError("open " + path);
+        }
+    }
+    explicit FileHandle(int fd) : fd_(fd) {}
+    ~FileHandle() { ::close(fd_); }
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    int fd() const { return fd_; }
+
+    /**
+     * @brief Throws std::runtime_error unless the file holds at least `bytes` bytes.
+     * Mapping past the end of a file and reading it raises SIGBUS instead of an error.
+     * @param what Name used in the error message (usually the path).
+     */
+    void requireSize(std::size_t bytes, const std::string& what) const {
+        struct stat info;
+        if (::fstat(fd_, &info) != 0) {
+            throwSystemError("fstat " + what);
+        }
+        if (static_cast<std::uint64_t>(info.st_size) < bytes) {
+            throw std::runtime_error(what + ": file has " + std::to_string(info.st_size) + " bytes, expected " +
+                                     std::to_string(bytes));
+        }
+    }
+
+private:
+    int fd_;
+};
+
+/**
+ * @brief Owns an mmap of [offset, offset + length) of a file.
+ * The offset does not need to be page aligned; data() points at offset.
+ */
+class MappedRegion {
+public:
+    MappedRegion(int fd, std::size_t offset, std::size_t length, bool writable) {
+        const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t aligned = offset / page * page;
+        length_ = length + (offset - aligned);
+        if (length_ == 0) {
+            return;
+        }
+        const int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        base_ = ::mmap(nullptr, length_, prot, MAP_SHARED, fd, static_cast<off_t>(aligned));
+        if (base_ == MAP_FAILED) {
+            base_ = nullptr;
+            throwSystemError("mmap");
+        }
+        ::madvise(base_, length_, MADV_SEQUENTIAL);
+        data_ = static_cast<std::uint8_t*>(base_) + (offset - aligned);
+    }
+    ~MappedRegion() {
+        if (base_ != nullptr) {
+            ::munmap(base_, length_);
+        }
+    }
+    MappedRegion(const MappedRegion&) = delete;
+    MappedRegion& operator=(const MappedRegion&) = delete;
+
+    std::uint8_t* data() const { return data_; }
+
+private:
+    void* base_ = nullptr;
+    std::size_t length_ = 0;
+    std::uint8_t* data_ = nullptr;
+};
+
+/**
+ * @brief Rows firstRow.. of a byte map stored contiguously, indexed by global row.
+ */
+template <typename T>
+struct BandView {
+    T* base;
+    int firstRow;
+    std::size_t width;
+    T* operator[](int i) const { return base + static_cast<std::size_t>(i - firstRow) * width; }
+};
+
+/**
+ * @brief Writes a map as a raw file: one byte (0 or 1) per cell, row-major, no header.
+ * @param path Destination file.
+ * @param map The map to write.
+ * @param W Width of the map.
+ * @param H Height of the map.
+ */
+void writeMapFile(const std::string& path, const Map& map, int W, int H) {
+    FileHandle file(path, O_RDWR | O_CREAT | O_TRUNC);
+    const std::size_t size = static_cast<std::size_t>(W) * H;
+    if (::ftruncate(file.fd(), static_cast<off_t>(size)) != 0) {
+        throwSystemError("ftruncate " + path);
+    }
+    MappedRegion region(file.fd(), 0, size, true);
+    for (int i = 0; i < H; ++i) {
+        for (int j = 0; j < W; ++j) {
+            region.data()[static_cast<std::size_t>(i) * W + j] = map[i][j] ? 1 : 0;
+        }
+    }
+}
+
+/**
+ * @brief Reads a raw map file written by writeMapFile or cellularAutomataFile.
+ * @param path Source file.
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @return The map.
+ */
+Map readMapFile(const std::string& path, int W, int H) {
+    FileHandle file(path, O_RDONLY);
+    file.requireSize(static_cast<std::size_t>(W) * H, path);
+    MappedRegion region(file.fd(), 0, static_cast<std::size_t>(W) * H, false);
+    Map map(H, std::vector<int>(W, 0));
+    for (int i = 0; i < H; ++i) {
+        for (int j = 0; j < W; ++j) {
+            map[i][j] = region.data()[static_cast<std::size_t>(i) * W + j];
+        }
+    }
+    return map;
+}
+
+/**
+ * @brief Out-of-core Cellular Automata step between two raw map files.
+ * The map is processed in bands of bandRows rows: for each band only the
+ * band plus its R-row halos are memory-mapped from the input and only the
+ * band is mapped in the output, and both are unmapped before the next band.
+ * Peak mapped memory is therefore about (bandRows + 2R) * W bytes, whatever
+ * the map size. Each band is computed with cellularAutomataSlidingRows.
+ * @param inputPath Raw map file (see writeMapFile) holding the current state.
+ * @param outputPath File that receives the next generation (created or truncated).
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @param bandRows Rows computed per band.
+ */
+void cellularAutomataFile(const std::string& inputPath, const std::string& outputPath,
+                          int W, int H, int R, double U, int bandRows = 256) {
+    FileHandle input(inputPath, O_RDONLY);
+    input.requireSize(static_cast<std::size_t>(W) * H, inputPath);
+    FileHandle output(outputPath, O_RDWR | O_CREAT | O_TRUNC);
+    const std::size_t width = static_cast<std::size_t>(W);
+    if (::ftruncate(output.fd(), static_cast<off_t>(width * H)) != 0) {
+        throwSystemError("ftruncate " + outputPath);
+    }
+    if (W <= 0) {
+        return;
+    }
+    bandRows = std::max(1, bandRows);
+
+    for (int band = 0; band < H; band += bandRows) {
+        const int bandEnd = std::min(H, band + bandRows);
+        const int haloBegin = std::max(0, band - R);
+        const int haloEnd = std::min(H, bandEnd + R);
+
+        MappedRegion in(input.fd(), haloBegin * width, (haloEnd - haloBegin) * width, false);
+        MappedRegion out(output.fd(), band * width, (bandEnd - band) * width, true);
+        const BandView<const std::uint8_t> src{in.data(), haloBegin, width};
+        BandView<std::uint8_t> dst{out.data(), band, width};
+        cellularAutomataSlidingRows(src, dst, W, H, R, U, band, bandEnd);
+    }
+}
+#endif
+
+#ifdef PCG_POSIX
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+/**
+ * @brief Cellular Automata run split across worker processes that share halos.
+ * The map is cut into horizontal shards, one per forked worker. Each worker
+ * keeps its shard plus R halo rows above and below in private memory. After
+ * every generation it publishes its first and last R rows to a POSIX shared
+ * memory segment, waits on a process-shared barrier, and copies its
+ * neighbors' rows into its halos. Halo slots alternate between two parities,
+ * so one barrier per generation is enough. Workers write their final shard to
+ * the shared segment and the parent assembles newMap. The result equals
+ * `generations` applications of cellularAutomata. If a worker fails or dies,
+ * the parent kills the others, which may be stuck at the barrier, and throws
+ * std::runtime_error.
+ * @param currentMap The map in its current state.
+ * @param newMap Receives the final generation (resized as needed).
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @param generations Number of generations to run.
+ * @param numWorkers Requested worker processes; reduced so every shard has at least R rows.
+ */
+void cellularAutomataSharded(const Map& currentMap, Map& newMap, int W, int H, int R, double U,
+                             int generations, int numWorkers) {
+    newMap.assign(H, std::vector<int>(W, 0));
+    if (W <= 0 || H <= 0) {
+        return;
+    }
+    const int workers = std::max(1, std::min(numWorkers, (R > 0) ? H / R : H));
+    const std::size_t width = static_cast<std::size_t>(W);
+    const std::size_t haloBytes = static_cast<std::size_t>(R) * width;
+
+    // Segmento: barrera | halos [worker][paridad][arriba/abajo] | resultado H x W
+    const std::size_t barrierBytes = (sizeof(pthread_barrier_t) + 63) / 64 * 64;
+    const std::size_t halosOffset = barrierBytes;
+    const std::size_t resultOffset = halosOffset + static_cast<std::size_t>(workers) * 4 * haloBytes;
+    const std::size_t totalBytes = resultOffset + width * H;
+
+    static std::atomic<int> segmentCounter{0};
+    const std::string name = "/rulebasedpcg-" + std::to_string(::getpid()) + "-" +
+                             std::to_string(segmentCounter.fetch_add(1));
+    const int shmFd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (shmFd < 0) {
+        throwSystemError("shm_open " + name);
+    }
+    FileHandle shm(shmFd);
+    ::shm_unlink(name.c_str()); // El mapeo sigue vivo y lo heredan los hijos
+    if (::ftruncate(shm.fd(), static_cast<off_t>(totalBytes)) != 0) {
+        throwSystemError("ftruncate " + name);
+    }
+    MappedRegion segment(shm.fd(), 0, totalBytes, true);
+    std::uint8_t* base = segment.data();
+
+    auto* barrier = reinterpret_cast<pthread_barrier_t*>(base);
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(barrier, &attr, static_cast<unsigned>(workers));
+    pthread_barrierattr_destroy(&attr);
+
+    // side 0: primeras R filas del shard, side 1: últimas R filas
+    auto haloSlot = [&](int worker, int parity, int side) {
+        return base + halosOffset + ((static_cast<std::size_t>(worker) * 2 + parity) * 2 + side) * haloBytes;
+    };
+
+    auto runWorker = [&](int worker) {
+        const int shardBegin = static_cast<int>(static_cast<long long>(H) * worker / workers);
+        const int shardEnd = static_cast<int>(static_cast<long long>(H) * (worker + 1) / workers);
+        const int shardH = shardEnd - shardBegin;
+        const int localH = shardH + 2 * R;
+
+        // Filas locales: [0, R) halo superior, [R, R + shardH) shard, resto halo inferior
+        Map front(localH, std::vector<int>(W, 0));
+        for (int i = 0; i < localH; ++i) {
+            const int gi = shardBegin - R + i;
+            if (gi >= 0 && gi < H) {
+                front[i] = currentMap[gi];
+            }
+        }
+        Map back = front;
+
+        for (int g = 0; g < generations; ++g) {
+            if (g > 0) {
+                const int parity = g & 1;
+                for (int r = 0; r < R; ++r) {
+                    std::copy(front[R + r].begin(), front[R + r].end(), haloSlot(worker, parity, 0) + r * width);
+                    std::copy(front[shardH + r].begin(), front[shardH + r].end(), haloSlot(worker, parity, 1) + r * width);
+                }
+                pthread_barrier_wait(barrier);
+                for (int r = 0; r < R; ++r) {
+                    if (worker > 0) {
+                        const std::uint8_t* src = haloSlot(worker - 1, parity, 1) + r * width;
+                        std::copy(src, src + width, front[r].begin());
+                    }
+                    if (worker + 1 < workers) {
+                        const std::uint8_t* src = haloSlot(worker + 1, parity, 0) + r * width;
+                        std::copy(src, src + width, front[R + shardH + r].begin());
+                    }
+                }
+            }
+            cellularAutomataRegionSpecialized(front, back, W, localH, R, U, R, R + shardH, 0, W);
+            front.swap(back);
+        }
+
+        std::uint8_t* out = base + resultOffset + static_cast<std::size_t>(shardBegin) * width;
+        for (int i = 0; i < shardH; ++i) {
+            std::copy(front[R + i].begin(), front[R + i].end(), out + i * width);
+        }
+    };
+
+    std::vector<pid_t> children;
+    for (int worker = 0; worker < workers; ++worker) {
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            int status = 0;
+            try {
+                runWorker(worker);
+            } catch (...) {
+                status = 1;
+            }
+            ::_exit(status);
+        }
+        if (pid < 0) {
+            // Sin todos los trabajadores la barrera nunca se liberaría
+            for (pid_t child : children) {
+                ::kill(child, SIGKILL);
+                ::waitpid(child, nullptr, 0);
+            }
+            // Sin pthread_barrier_destroy: glibc espera a que salgan los procesos muertos en la barrera
+            throwSystemError("fork");
+        }
+        children.push_back(pid);
+    }
+
+    // Si un trabajador falla, los demás quedarían bloqueados para siempre en la barrera:
+    // se sondea a los hijos sin bloquear y, tras el primer fallo, se mata al resto
+    bool failed = false;
+    std::size_t running = children.size();
+    auto pollDelay = std::chrono::microseconds(20);
+    while (running > 0) {
+        bool progress = false;
+        for (pid_t& child : children) {
+            if (child <= 0) {
+                continue;
+            }
+            int status = 0;
+            const pid_t done = ::waitpid(child, &status, WNOHANG);
+            if (done == 0) {
+                continue;
+            }
+            if (done < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                failed = true;
+            }
+            child = 0;
+            --running;
+            progress = true;
+        }
+        if (failed) {
+            for (pid_t& child : children) {
+                if (child > 0) {
+                    ::kill(child, SIGKILL);
+                    ::waitpid(child, nullptr, 0);
+                    child = 0;
+                }
+            }
+            break;
+        }
+        if (!progress) {
+            std::this_thread::sleep_for(pollDelay);
+            pollDelay = std::min(pollDelay * 2, std::chrono::microseconds(2000));
+        }
+    }
+    if (failed) {
+        // La barrera puede haber quedado con esperas de procesos muertos; el segmento se descarta igualmente
+        throw std::runtime_error("cellularAutomataSharded: a worker process failed");
+    }
+    pthread_barrier_destroy(barrier);
+
+    const std::uint8_t* result = base + resultOffset;
+    for (int i = 0; i < H; ++i) {
+        std::copy(result + i * width, result + (i + 1) * width, newMap[i].begin());
+    }
+}
+#endif
+
+/**
+ * @brief Hash of one map row, folded into a running map hash.
+ * Cells are packed 64 to a word and mixed FNV-1a style, one word at a time.
+ */
+template <typename RowT>
+std::uint64_t hashRow(std::uint64_t hash, const RowT& row, int W) {
+    const std::uint64_t prime = 0x100000001b3ULL;
+    for (int j0 = 0; j0 < W; j0 += 64) {
+        std::uint64_t word = 0;
+        const int j1 = std::min(W, j0 + 64);
+        for (int j = j0; j < j1; ++j) {
+            word |= static_cast<std::uint64_t>(row[j] != 0) << (j - j0);
+        }
+        hash = (hash ^ word) * prime;
+    }
+    return (hash ^ 0xffULL) * prime; // Separador de fila
+}
+
+/**
+ * @brief Hash identifying a whole generation.
+ * @param map The map to hash.
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @return A 64-bit hash of the cells.
+ */
+template <typename MapT>
+std::uint64_t hashMap(const MapT& map, int W, int H) {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < H; ++i) {
+        hash = hashRow(hash, map[i], W);
+    }
+    return hash;
+}
+
+/**
+ * @brief What a Cellular Automata step changed.
+ */
+struct StepStats {
+    long long flipped = 0;  // Celdas que cambiaron de valor
+    std::uint64_t hash = 0; // Hash de la nueva generación (ver hashMap)
+};
+
+/**
+ * @brief cellularAutomataInto that also counts flipped cells and hashes the result.
+ * Flips and hash are accumulated row by row right after each row is
+ * computed, while it is still in cache.
+ * @param currentMap The map in its current state.
+ * @param newMap Destination for the next generation (must not alias currentMap).
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @return Number of flipped cells and hash of newMap.
+ */
+template <typename MapT>
+StepStats cellularAutomataStats(const MapT& currentMap, MapT& newMap, int W, int H, int R, double U) {
+    StepStats stats;
+    stats.hash = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < H; ++i) {
+        cellularAutomataRegionSpecialized(currentMap, newMap, W, H, R, U, i, i + 1, 0, W);
+        for (int j = 0; j < W; ++j) {
+            stats.flipped += (newMap[i][j] != currentMap[i][j]);
+        }
+        stats.hash = hashRow(stats.hash, newMap[i], W);
+    }
+    return stats;
+}
+
+/**
+ * @brief How a runCellularAutomata call ended.
+ */
+struct RunResult {
+    int generations = 0; // Generaciones efectivamente calculadas
+    int period = 0;      // 0: se alcanzó el máximo, 1: punto fijo, p > 1: ciclo de periodo p
+};
+
+/**
+ * @brief Runs the Cellular Automata until it converges, cycles, or hits maxGenerations.
+ * A generation with no flipped cells is a fixed point. Otherwise the hash of
+ * each generation is compared with the last maxPeriod ones, and a match is
+ * taken as a cycle of that period (64-bit hashes, so collisions are
+ * negligible but not impossible). The final generation is left in front.
+ * @param front The map in its current state; receives the final generation.
+ * @param back Scratch buffer with the same dimensions.
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @param maxGenerations Upper bound on the number of generations.
+ * @param maxPeriod Longest cycle that is detected.
+ * @return Generations run and detected period.
+ */
+template <typename MapT>
+RunResult runCellularAutomata(MapT& front, MapT& back, int W, int H, int R, double U,
+                              int maxGenerations, int maxPeriod = 8) {
+    RunResult result;
+    maxPeriod = std::max(1, maxPeriod);
+    // Historial circular: history[g % maxPeriod] = hash de la generación g
+    std::vector<std::uint64_t> history(maxPeriod, 0);
+    history[0] = hashMap(front, W, H);
+
+    for (int g = 1; g <= maxGenerations; ++g) {
+        const StepStats stats = cellularAutomataStats(front, back, W, H, R, U);
+        std::swap(front, back);
+        result.generations = g;
+        if (stats.flipped == 0) {
+            result.period = 1;
+            return result;
+        }
+        for (int p = 2; p <= std::min(maxPeriod, g); ++p) {
+            if (history[(g - p) % maxPeriod] == stats.hash) {
+                result.period = p;
+                return result;
+            }
+        }
+        history[g % maxPeriod] = stats.hash;
+    }
+    return result;
+}
+
+/**
+ * @brief Function to implement the Cellular Automata logic.
+ * It should take a map and return the updated map after one iteration.
+ * @param currentMap The map in its current state.
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * Works on a Map or on a Grid (anything indexable as map[i][j]).
+ * @return The map after applying the cellular automata rules.
+ */
+template <typename MapT>
+MapT cellularAutomata(const MapT& currentMap, int W, int H, int R, double U) {
+    MapT newMap = currentMap; // Copia del mapa actual
+    cellularAutomataInto(currentMap, newMap, W, H, R, U);
+
+    return newMap;
+}
+
+/**
+ * @brief Cellular Automata step that counts neighbors with a summed-area table.
+ * The integral image is built once per generation, so each window count is
+ * answered with four lookups and the cost no longer depends on R. Cells
+ * outside the map count as 0, exactly like cellularAutomata.
+ * @param currentMap The map in its current state.
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @return The map after applying the cellular automata rules.
+ */
+Map cellularAutomataSAT(const Map& currentMap, int W, int H, int R, double U) {
+    Map newMap = currentMap;
+
+    // sat[(i+1)*(W+1) + (j+1)] = suma de las celdas en [0..i] x [0..j]
+    const std::size_t stride = static_cast<std::size_t>(W) + 1;
+    std::vector<long long> sat((static_cast<std::size_t>(H) + 1) * stride, 0);
+    for (int i = 0; i < H; ++i) {
+        long long rowSum = 0;
+        for (int j = 0; j < W; ++j) {
+            rowSum += currentMap[i][j];
+            sat[(i + 1) * stride + (j + 1)] = sat[i * stride + (j + 1)] + rowSum;
+        }
+    }
+
+    const double windowArea = static_cast<double>((2 * R + 1) * (2 * R + 1));
+    for (int i = 0; i < H; ++i) {
+        // Ventana recortada a los bordes del mapa
+        const std::size_t top = static_cast<std::size_t>(std::max(0, i - R));
+        const std::size_t bottom = static_cast<std::size_t>(std::min(H - 1, i + R)) + 1;
+        for (int j = 0; j < W; ++j) {
+            const std::size_t left = static_cast<std::size_t>(std::max(0, j - R));
+            const std::size_t right = static_cast<std::size_t>(std::min(W - 1, j + R)) + 1;
+            long long countOnes = sat[bottom * stride + right] - sat[top * stride + right]
+                                - sat[bottom * stride + left] + sat[top * stride + left];
+            double neighborRatio = static_cast<double>(countOnes) / windowArea;
+            newMap[i][j] = (neighborRatio > U) ? 1 : 0;
+        }
+    }
+
+    return newMap;
+}
+
+/**
+ * @brief Bit-packed binary map, 64 cells per word.
+ * Bit j of word k in a row holds column 64*k + j. Padding bits past W are
+ * always kept at 0 so that whole-word operations never see garbage.
+ */
+struct BitMap {
+    int W = 0;
+    int H = 0;
+    int wordsPerRow = 0;
+    std::vector<std::uint64_t> words;
+
+    BitMap() = default;
+    BitMap(int W, int H)
+        : W(W), H(H), wordsPerRow((W + 63) / 64),
+          words(static_cast<std::size_t>(H) * ((W + 63) / 64), 0) {}
+
+    std::uint64_t* row(int i) { return words.data() + static_cast<std::size_t>(i) * wordsPerRow; }
+    const std::uint64_t* row(int i) const { return words.data() + static_cast<std::size_t>(i) * wordsPerRow; }
+
+    int get(int i, int j) const { return static_cast<int>((row(i)[j >> 6] >> (j & 63)) & 1u); }
+    void set(int i, int j, int value) {
+        const std::uint64_t bit = std::uint64_t{1} << (j & 63);
+        if (value) {
+            row(i)[j >> 6] |= bit;
+        } else {
+            row(i)[j >> 6] &= ~bit;
+        }
+    }
+};
+
+/**
+ * @brief Packs a Map into a BitMap (any non-zero cell becomes 1).
+ * @param map The map to pack.
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @return The packed map.
+ */
+BitMap toBitMap(const Map& map, int W, int H) {
+    BitMap bits(W, H);
+    for (int i = 0; i < H; ++i) {
+        std::uint64_t* out = bits.row(i);
+        for (int j = 0; j < W; ++j) {
+            if (map[i][j] != 0) {
+                out[j >> 6] |= std::uint64_t{1} << (j & 63);
+            }
+        }
+    }
+    return bits;
+}
+
+/**
+ * @brief Unpacks a BitMap back into a Map of 0/1 integers.
+ * @param bits The packed map.
+ * @return The unpacked map.
+ */
+Map fromBitMap(const BitMap& bits) {
+    Map map(bits.H, std::vector<int>(bits.W, 0));
+    for (int i = 0; i < bits.H; ++i) {
+        for (int j = 0; j < bits.W; ++j) {
+            map[i][j] = bits.get(i, j);
+        }
+    }
+    return map;
+}
+
+/**
+ * @brief Cellular Automata step for R = 1 working on 64 cells at a time.
+ * The nine neighbor bitplanes of each word are added with bit-sliced full
+ * adders into a 4-bit count per cell, which is then compared against the
+ * threshold with word-wide logic. Cells outside the map count as 0.
+ * @param currentMap The packed map in its current state.
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @return The packed map after applying the cellular automata rules.
+ */
+BitMap cellularAutomataBits(const BitMap& currentMap, double U) {
+    const int W = currentMap.W;
+    const int H = currentMap.H;
+    const int words = currentMap.wordsPerRow;
+    BitMap newMap(W, H);
+    if (W == 0 || H == 0) {
+        return newMap;
+    }
+
+    const int threshold = minCountAbove(1, U);
+    const std::uint64_t lastMask = (W % 64 == 0) ? ~std::uint64_t{0} : ((std::uint64_t{1} << (W % 64)) - 1);
+
+    // Suma (0..3) de una fila de tres celdas: izquierda, centro y derecha
+    auto rowSum = [&](const std::uint64_t* r, int k, std::uint64_t& s0, std::uint64_t& s1) {
+        if (r == nullptr) {
+            s0 = s1 = 0;
+            return;
+        }
+        const std::uint64_t c = r[k];
+        const std::uint64_t prev = (k > 0) ? r[k - 1] : 0;
+        const std::uint64_t next = (k + 1 < words) ? r[k + 1] : 0;
+        const std::uint64_t west = (c << 1) | (prev >> 63);
+        const std::uint64_t east = (c >> 1) | (next << 63);
+        s0 = west ^ c ^ east;
+        s1 = (west & c) | (west & east) | (c & east);
+    };
+
+    for (int i = 0; i < H; ++i) {
+        const std::uint64_t* above = (i > 0) ? currentMap.row(i - 1) : nullptr;
+        const std::uint64_t* middle = currentMap.row(i);
+        const std::uint64_t* below = (i + 1 < H) ? currentMap.row(i + 1) : nullptr;
+        std::uint64_t* out = newMap.row(i);
+
+        for (int k = 0; k < words; ++k) {
+            std::uint64_t a0, a1, b0, b1, c0, c1;
+            rowSum(above, k, a0, a1);
+            rowSum(middle, k, b0, b1);
+            rowSum(below, k, c0, c1);
+
+            // Sumar las tres filas: bit 0 de peso 1, luego los de peso 2
+            const std::uint64_t bit0 = a0 ^ b0 ^ c0;
+            const std::uint64_t carry0 = (a0 & b0) | (a0 & c0) | (b0 & c0);
+            const std::uint64_t t0 = a1 ^ b1 ^ c1;
+            const std::uint64_t t1 = (a1 & b1) | (a1 & c1) | (b1 & c1);
+            const std::uint64_t bit1 = t0 ^ carry0;
+            const std::uint64_t carry1 = t0 & carry0;
+            const std::uint64_t bit2 = t1 ^ carry1;
+            const std::uint64_t bit3 = t1 & carry1;
+            const std::uint64_t count[4] = {bit0, bit1, bit2, bit3};
+
+            // count >= threshold, comparando desde el bit más significativo
+            std::uint64_t result;
+            if (threshold <= 0) {
+                result = ~std::uint64_t{0};
+            } else if (threshold > 9) {
+                result = 0;
+            } else {
+                const int t = threshold - 1; // count > t
+                std::uint64_t greater = 0;
+                std::uint64_t equal = ~std::uint64_t{0};
+                for (int b = 3; b >= 0; --b) {
+                    if ((t >> b) & 1) {
+                        equal &= count[b];
+                    } else {
+                        greater |= equal & count[b];
+                        equal &= ~count[b];
+                    }
+                }
+                result = greater;
+            }
+            out[k] = (k + 1 == words) ? (result & lastMask) : result;
+        }
+    }
+
+    return newMap;
+}
+
+/**
+ * @brief Next state of the center cell for every 3x3 neighborhood (R = 1).
+ * Index bits are three 3-bit columns, left column in the high bits; within a
+ * column bit 0 is the row above, bit 1 the cell's row and bit 2 the row below.
+ */
+using NeighborhoodLut = std::array<std::uint8_t, 512>;
+
+/**
+ * @brief Builds the 512-entry 3x3 table for the threshold rule.
+ * @param R Radius of the neighbor window; only R = 1 fits a 3x3 table.
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @return The lookup table.
+ */
+NeighborhoodLut buildNeighborhoodLut(int R, double U) {
+    if (R != 1) {
+        throw std::invalid_argument("buildNeighborhoodLut: only R = 1 is supported");
+    }
+    const int threshold = minCountAbove(R, U);
+    NeighborhoodLut lut{};
+    for (int index = 0; index < 512; ++index) {
+        int countOnes = 0;
+        for (int b = 0; b < 9; ++b) {
+            countOnes += (index >> b) & 1;
+        }
+        lut[index] = (countOnes >= threshold) ? 1 : 0;
+    }
+    return lut;
+}
+
+/**
+ * @brief Builds the 65536-entry table mapping a 4x4 block to its inner 2x2 outputs.
+ * Index bits are four 4-bit columns, leftmost column in the high bits; within
+ * a column bit r is row r of the block. The result holds output (r, c) of the
+ * inner 2x2 block in bit 2 * r + c.
+ * @param R Radius of the neighbor window; only R = 1 fits a 4x4 table.
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @return The lookup table.
+ */
+std::vector<std::uint8_t> buildNeighborhoodLut4x4(int R, double U) {
+    if (R != 1) {
+        throw std::invalid_argument("buildNeighborhoodLut4x4: only R = 1 is supported");
+    }
+    const int threshold = minCountAbove(R, U);
+    std::vector<std::uint8_t> lut(1 << 16, 0);
+    for (int index = 0; index < (1 << 16); ++index) {
+        auto cell = [index](int r, int c) { return (index >> ((3 - c) * 4 + r)) & 1; };
+        std::uint8_t out = 0;
+        for (int r = 0; r < 2; ++r) {
+            for (int c = 0; c < 2; ++c) {
+                int countOnes = 0;
+                for (int dr = 0; dr < 3; ++dr) {
+                    for (int dc = 0; dc < 3; ++dc) {
+                        countOnes += cell(r + dr, c + dc);
+                    }
+                }
+                out |= static_cast<std::uint8_t>((countOnes >= threshold) ? 1 : 0) << (2 * r + c);
+            }
+        }
+        lut[index] = out;
+    }
+    return lut;
+}
+
+/**
+ * @brief Word k of a packed row with the bits past column W cleared; 0 for a missing row or word.
+ */
+inline std::uint64_t packedWord(const std::uint64_t* row, int k, int words, std::uint64_t lastMask) {
+    if (row == nullptr || k >= words) {
+        return 0;
+    }
+    return (k + 1 == words) ? (row[k] & lastMask) : row[k];
+}
+
+/**
+ * @brief Spreads a 10-column window of one row into the column slots of a table index.
+ * Bit i of the window (column j - 1 + i) goes to bit Slot * (9 - i), so the
+ * leftmost column lands in the highest slot, matching NeighborhoodLut
+ * (Slot = 3) and buildNeighborhoodLut4x4 (Slot = 4).
+ */
+template <int Slot>
+const std::array<std::uint64_t, 1024>& columnSpreadTable() {
+    static const std::array<std::uint64_t, 1024> table = [] {
+        std::array<std::uint64_t, 1024> t{};
+        for (unsigned window = 0; window < 1024; ++window) {
+            for (int i = 0; i < 10; ++i) {
+                t[window] |= static_cast<std::uint64_t>((window >> i) & 1u) << (Slot * (9 - i));
+            }
+        }
+        return t;
+    }();
+    return table;
+}
+
+/**
+ * @brief Ten-column windows (columns 64k - 1 .. 64k + 64) of one packed row word, eight per word.
+ * window(g) holds columns 64k + 8g - 1 .. 64k + 8g + 8 in its low 10 bits.
+ */
+struct PackedWindows {
+    std::uint64_t shifted; // bit c = columna 64k + c - 1
+    unsigned tail;         // columnas 64k + 63 y 64k + 64
+
+    PackedWindows(std::uint64_t previous, std::uint64_t current, std::uint64_t next)
+        : shifted((current << 1) | (previous >> 63)),
+          tail(static_cast<unsigned>((current >> 63) | (next & 1) << 1)) {}
+
+    unsigned window(int g) const {
+        return (g < 7) ? static_cast<unsigned>((shifted >> (8 * g)) & 1023u)
+                       : static_cast<unsigned>(shifted >> 56) | (tail << 8);
+    }
+};
+
+/**
+ * @brief Cellular Automata step for R = 1 by 3x3 table lookup over packed rows.
+ * Cells are processed eight at a time. For each row, the ten columns
+ * j-1 .. j+8 are cut from the current word (with the neighbor words' edge
+ * bits carried in) and spread into 3-bit column slots by one table read.
+ * OR-ing the three rows gives a 30-bit string of column triples. Four
+ * independent 12-bit slices of it index a 4096-entry pair table, derived from
+ * lut once per call, that yields two adjacent cells per lookup. Map edges are
+ * handled once per word (missing rows and words read as 0) instead of once
+ * per cell.
+ * @param currentMap The packed map in its current state.
+ * @param lut Table from buildNeighborhoodLut.
+ * @return The packed map after applying the cellular automata rules.
+ */
+BitMap cellularAutomataLut(const BitMap& currentMap, const NeighborhoodLut& lut) {
+    const int W = currentMap.W;
+    const int H = currentMap.H;
+    BitMap newMap(W, H);
+    const int words = currentMap.wordsPerRow;
+    if (words == 0) {
+        return newMap;
+    }
+    const std::uint64_t lastMask = (W % 64 == 0) ? ~std::uint64_t{0} : ((std::uint64_t{1} << (W % 64)) - 1);
+    const std::array<std::uint64_t, 1024>& spread = columnSpreadTable<3>();
+
+    // Tabla de pares: índice de 4 columnas (j-1 .. j+2) -> celdas j (bit 0) y j+1 (bit 1)
+    std::array<std::uint8_t, 4096> pairs;
+    for (unsigned index = 0; index < 4096; ++index) {
+        pairs[index] = static_cast<std::uint8_t>(lut[index >> 3] | lut[index & 511u] << 1);
+    }
+
+    for (int i = 0; i < H; ++i) {
+        const std::uint64_t* rows[3] = {(i > 0) ? currentMap.row(i - 1) : nullptr, currentMap.row(i),
+                                        (i + 1 < H) ? currentMap.row(i + 1) : nullptr};
+        std::uint64_t previous[3] = {0, 0, 0};
+        std::uint64_t current[3];
+        for (int r = 0; r < 3; ++r) {
+            current[r] = packedWord(rows[r], 0, words, lastMask);
+        }
+
+        std::uint64_t* out = newMap.row(i);
+        for (int k = 0; k < words; ++k) {
+            const PackedWindows windows[3] = {
+                {previous[0], current[0], packedWord(rows[0], k + 1, words, lastMask)},
+                {previous[1], current[1], packedWord(rows[1], k + 1, words, lastMask)},
+                {previous[2], current[2], packedWord(rows[2], k + 1, words, lastMask)}};
+            for (int r = 0; r < 3; ++r) {
+                previous[r] = current[r];
+                current[r] = packedWord(rows[r], k + 1, words, lastMask);
+            }
+            std::uint64_t word = 0;
+            for (int g = 0; g < 8; ++g) {
+                // 10 columnas x 3 filas: ocho índices de 9 bits solapados
+                const std::uint64_t indices = spread[windows[0].window(g)] | spread[windows[1].window(g)] << 1 |
+                                              spread[windows[2].window(g)] << 2;
+                // Cuatro búsquedas independientes de dos celdas cada una
+                const std::uint64_t bits =
+                    static_cast<std::uint64_t>(pairs[(indices >> 18) & 4095u]) |
+                    static_cast<std::uint64_t>(pairs[(indices >> 12) & 4095u]) << 2 |
+                    static_cast<std::uint64_t>(pairs[(indices >> 6) & 4095u]) << 4 |
+                    static_cast<std::uint64_t>(pairs[indices & 4095u]) << 6;
+                word |= bits << (8 * g);
+            }
+            out[k] = (k + 1 == words) ? (word & lastMask) : word;
+        }
+    }
+    return newMap;
+}
+
+/**
+ * @brief Cellular Automata step for R = 1 producing 2x2 output blocks per lookup.
+ * Each lookup reads a 4x4 block (rows i-1..i+2, columns j-1..j+2) and yields
+ * cells (i, j), (i, j+1), (i+1, j) and (i+1, j+1). As in cellularAutomataLut,
+ * ten-column windows of the four rows are spread into 4-bit column slots, so
+ * eight columns of two output rows come from four independent lookups with no
+ * per-cell bounds checks.
+ * @param currentMap The packed map in its current state.
+ * @param lut Table from buildNeighborhoodLut4x4.
+ * @return The packed map after applying the cellular automata rules.
+ */
+BitMap cellularAutomataLut4x4(const BitMap& currentMap, const std::vector<std::uint8_t>& lut) {
+    const int W = currentMap.W;
+    const int H = currentMap.H;
+    BitMap newMap(W, H);
+    const int words = currentMap.wordsPerRow;
+    if (words == 0) {
+        return newMap;
+    }
+    const std::uint64_t lastMask = (W % 64 == 0) ? ~std::uint64_t{0} : ((std::uint64_t{1} << (W % 64)) - 1);
+    const std::array<std::uint64_t, 1024>& spread = columnSpreadTable<4>();
+
+    for (int i = 0; i < H; i += 2) {
+        const std::uint64_t* rows[4];
+        std::uint64_t previous[4] = {0, 0, 0, 0};
+        std::uint64_t current[4];
+        for (int r = 0; r < 4; ++r) {
+            const int ni = i - 1 + r;
+            rows[r] = (ni >= 0 && ni < H) ? currentMap.row(ni) : nullptr;
+            current[r] = packedWord(rows[r], 0, words, lastMask);
+        }
+
+        std::uint64_t* out0 = newMap.row(i);
+        std::uint64_t* out1 = (i + 1 < H) ? newMap.row(i + 1) : nullptr;
+        for (int k = 0; k < words; ++k) {
+            PackedWindows windows[4] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+            for (int r = 0; r < 4; ++r) {
+                const std::uint64_t next = packedWord(rows[r], k + 1, words, lastMask);
+                windows[r] = PackedWindows(previous[r], current[r], next);
+                previous[r] = current[r];
+                current[r] = next;
+            }
+            std::uint64_t word0 = 0;
+            std::uint64_t word1 = 0;
+            for (int g = 0; g < 8; ++g) {
+                // 10 columnas x 4 filas: cuatro índices de 16 bits, uno por bloque 2x2
+                const std::uint64_t indices = spread[windows[0].window(g)] | spread[windows[1].window(g)] << 1 |
+                                              spread[windows[2].window(g)] << 2 | spread[windows[3].window(g)] << 3;
+                const unsigned blocks = static_cast<unsigned>(lut[(indices >> 24) & 0xFFFFu]) |
+                                        static_cast<unsigned>(lut[(indices >> 16) & 0xFFFFu]) << 4 |
+                                        static_cast<unsigned>(lut[(indices >> 8) & 0xFFFFu]) << 8 |
+                                        static_cast<unsigned>(lut[indices & 0xFFFFu]) << 12;
+                // Bits 0-1 de cada bloque van a la fila i, bits 2-3 a la fila i+1
+                const unsigned bits0 = (blocks & 0x3u) | (blocks >> 2 & 0xCu) | (blocks >> 4 & 0x30u) |
+                                       (blocks >> 6 & 0xC0u);
+                const unsigned bits1 = (blocks >> 2 & 0x3u) | (blocks >> 4 & 0xCu) | (blocks >> 6 & 0x30u) |
+                                       (blocks >> 8 & 0xC0u);
+                word0 |= static_cast<std::uint64_t>(bits0) << (8 * g);
+                word1 |= static_cast<std::uint64_t>(bits1) << (8 * g);
+            }
+            const std::uint64_t mask = (k + 1 == words) ? lastMask : ~std::uint64_t{0};
+            out0[k] = word0 & mask;
+            if (out1 != nullptr) {
+                out1[k] = word1 & mask;
+            }
+        }
+    }
+    return newMap;
+}
+
+/**
+ * @brief Row kernel for the threshold rule.
+ * Adds the given window rows into colSum (padded with R zeros on each side,
+ * so it holds W + 2R entries) and writes out[j] = 1 when the (2R+1)-wide
+ * horizontal window sum centered on column j reaches threshold, 0 otherwise.
+ */
+using CaRowKernel = void (*)(const int* const* rows, int numRows, int* colSum,
+                             int* out, int W, int R, int threshold);
+
+/**
+ * @brief Portable row kernel, used when no SIMD extension is available.
+ */
+void caRowKernelScalar(const int* const* rows, int numRows, int* colSum,
+                       int* out, int W, int R, int threshold) {
+    int* sums = colSum + R;
+    for (int j = 0; j < W; ++j) {
+        int s = 0;
+        for (int r = 0; r < numRows; ++r) {
+            s += rows[r][j];
+        }
+        sums[j] = s;
+    }
+    for (int j = 0; j < W; ++j) {
+        int countOnes = 0;
+        for (int d = 0; d <= 2 * R; ++d) {
+            countOnes += colSum[j + d];
+        }
+        out[j] = (countOnes >= threshold) ? 1 : 0;
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PCG_X86_SIMD 1
+#include <immintrin.h>
+
+__attribute__((target("sse4.2")))
+void caRowKernelSSE42(const int* const* rows, int numRows, int* colSum,
+                      int* out, int W, int R, int threshold) {
+    int* sums = colSum + R;
+    int j = 0;
+    for (; j + 4 <= W; j += 4) {
+        __m128i s = _mm_setzero_si128();
+        for (int r = 0; r < numRows; ++r) {
+            s = _mm_add_epi32(s, _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + j)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + j), s);
+    }
+    for (; j < W; ++j) {
+        int s = 0;
+        for (int r = 0; r < numRows; ++r) {
+            s += rows[r][j];
+        }
+        sums[j] = s;
+    }
+
+    const __m128i limit = _mm_set1_epi32(threshold - 1);
+    const __m128i one = _mm_set1_epi32(1);
+    j = 0;
+    for (; j + 4 <= W; j += 4) {
+        __m128i countOnes = _mm_setzero_si128();
+        for (int d = 0; d <= 2 * R; ++d) {
+            countOnes = _mm_add_epi32(countOnes, _mm_loadu_si128(reinterpret_cast<const __m128i*>(colSum + j + d)));
+        }
+        const __m128i alive = _mm_and_si128(_mm_cmpgt_epi32(countOnes, limit), one);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), alive);
+    }
+    for (; j < W; ++j) {
+        int countOnes = 0;
+        for (int d = 0; d <= 2 * R; ++d) {
+            countOnes += colSum[j + d];
+        }
+        out[j] = (countOnes >= threshold) ? 1 : 0;
+    }
+}
+
+__attribute__((target("avx2")))
+void caRowKernelAVX2(const int* const* rows, int numRows, int* colSum,
+                     int* out, int W, int R, int threshold) {
+    int* sums = colSum + R;
+    int j = 0;
+    for (; j + 8 <= W; j += 8) {
+        __m256i s = _mm256_setzero_si256();
+        for (int r = 0; r < numRows; ++r) {
+            s = _mm256_add_epi32(s, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + j)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums + j), s);
+    }
+    for (; j < W; ++j) {
+        int s = 0;
+        for (int r = 0; r < numRows; ++r) {
+            s += rows[r][j];
+        }
+        sums[j] = s;
+    }
+
+    const __m256i limit = _mm256_set1_epi32(threshold - 1);
+    const __m256i one = _mm256_set1_epi32(1);
+    j = 0;
+    for (; j + 8 <= W; j += 8) {
+        __m256i countOnes = _mm256_setzero_si256();
+        for (int d = 0; d <= 2 * R; ++d) {
+            countOnes = _mm256_add_epi32(countOnes, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colSum + j + d)));
+        }
+        const __m256i alive = _mm256_and_si256(_mm256_cmpgt_epi32(countOnes, limit), one);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j), alive);
+    }
+    for (; j < W; ++j) {
+        int countOnes = 0;
+        for (int d = 0; d <= 2 * R; ++d) {
+            countOnes += colSum[j + d];
+        }
+        out[j] = (countOnes >= threshold) ? 1 : 0;
+    }
+}
+
+__attribute__((target("avx512f")))
+void caRowKernelAVX512(const int* const* rows, int numRows, int* colSum,
+                       int* out, int W, int R, int threshold) {
+    int* sums = colSum + R;
+    int j = 0;
+    for (; j + 16 <= W; j += 16) {
+        __m512i s = _mm512_setzero_si512();
+        for (int r = 0; r < numRows; ++r) {
+            s = _mm512_add_epi32(s, _mm512_loadu_si512(rows[r] + j));
+        }
+        _mm512_storeu_si512(sums + j, s);
+    }
+    for (; j < W; ++j) {
+        int s = 0;
+        for (int r = 0; r < numRows; ++r) {
+            s += rows[r][j];
+        }
+        sums[j] = s;
+    }
+
+    const __m512i limit = _mm512_set1_epi32(threshold - 1);
+    const __m512i one = _mm512_set1_epi32(1);
+    j = 0;
+    for (; j + 16 <= W; j += 16) {
+        __m512i countOnes = _mm512_setzero_si512();
+        for (int d = 0; d <= 2 * R; ++d) {
+            countOnes = _mm512_add_epi32(countOnes, _mm512_loadu_si512(colSum + j + d));
+        }
+        const __mmask16 alive = _mm512_cmpgt_epi32_mask(countOnes, limit);
+        _mm512_storeu_si512(out + j, _mm512_maskz_mov_epi32(alive, one));
+    }
+    for (; j < W; ++j) {
+        int countOnes = 0;
+        for (int d = 0; d <= 2 * R; ++d) {
+            countOnes += colSum[j + d];
+        }
+        out[j] = (countOnes >= threshold) ? 1 : 0;
+    }
+}
+#endif
+
+/**
+ * @brief Row kernel selected for this CPU, plus its name for diagnostics.
+ */
+struct CaRowKernelChoice {
+    CaRowKernel kernel;
+    const char* name;
+};
+
+/**
+ * @brief Picks the widest row kernel supported by the running CPU (CPUID).
+ * @return The selected kernel; the scalar one on non-x86 builds.
+ */
+CaRowKernelChoice selectCaRowKernel() {
+#ifdef PCG_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {caRowKernelAVX512, "avx512f"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {caRowKernelAVX2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return {caRowKernelSSE42, "sse4.2"};
+    }
+#endif
+    return {caRowKernelScalar, "scalar"};
+}
+
+// Se resuelve una sola vez, al iniciar el programa
+const CaRowKernelChoice caRowKernel = selectCaRowKernel();
+
+/**
+ * @brief Cellular Automata step using the runtime-selected SIMD row kernel.
+ * Each output row is produced a full vector of cells at a time: the window
+ * rows are summed column-wise, the horizontal window is added on top, and the
+ * neighborRatio > U test becomes an integer compare against minCountAbove.
+ * @param currentMap The map in its current state.
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @return The map after applying the cellular automata rules.
+ */
+Map cellularAutomataSIMD(const Map& currentMap, int W, int H, int R, double U) {
+    Map newMap(H, std::vector<int>(W, 0));
+    const int threshold = minCountAbove(R, U);
+    std::vector<int> colSum(static_cast<std::size_t>(W) + 2 * R, 0);
+    std::vector<const int*> rows(2 * R + 1);
+
+    for (int i = 0; i < H; ++i) {
+        // Filas de la ventana que caen dentro del mapa
+        int numRows = 0;
+        for (int ni = std::max(0, i - R); ni <= std::min(H - 1, i + R); ++ni) {
+            rows[numRows++] = currentMap[ni].data();
+        }
+        caRowKernel.kernel(rows.data(), numRows, colSum.data(), newMap[i].data(), W, R, threshold);
+    }
+
+    return newMap;
+}
+
+/**
+ * @brief Fixed-size pool of worker threads reused across calls.
+ * parallelFor hands out task indices to the workers and to the calling
+ * thread, and returns once every task has finished. Tasks must not throw,
+ * and parallelFor must not be called from several threads at once.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param numThreads Total threads working on each batch, caller included.
+     */
+    explicit ThreadPool(int numThreads = static_cast<int>(std::thread::hardware_concurrency())) {
+        const int extra = std::max(1, numThreads) - 1;
+        for (int t = 0; t < extra; ++t) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers_.size()) + 1; }
+
+    /**
+     * @brief Runs task(0) .. task(numTasks - 1) on the pool and waits for them.
+     */
+    void parallelFor(int numTasks, const std::function<void(int)>& task) {
+        if (numTasks <= 0) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = &task;
+            numTasks_ = numTasks;
+            nextTask_.store(0);
+            busyWorkers_ = static_cast<int>(workers_.size());
+            ++batch_;
+        }
+        wake_.notify_all();
+
+        runTasks(task, numTasks);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return busyWorkers_ == 0; });
+        task_ = nullptr;
+    }
+
+private:
+    void runTasks(const std::function<void(int)>& task, int numTasks) {
+        for (int t = nextTask_.fetch_add(1); t < numTasks; t = nextTask_.fetch_add(1)) {
+            task(t);
+        }
+    }
+
+    void workerLoop() {
+        std::uint64_t seenBatch = 0;
+        for (;;) {
+            const std::function<void(int)>* task;
+            int numTasks;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stop_ || batch_ != seenBatch; });
+                if (stop_) {
+                    return;
+                }
+                seenBatch = batch_;
+                task = task_;
+                numTasks = numTasks_;
+            }
+
+            runTasks(*task, numTasks);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--busyWorkers_ == 0) {
+                done_.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(int)>* task_ = nullptr;
+    int numTasks_ = 0;
+    std::atomic<int> nextTask_{0};
+    int busyWorkers_ = 0;
+    std::uint64_t batch_ = 0;
+    bool stop_ = false;
+};
+
+/**
+ * @brief Multithreaded Cellular Automata step over rectangular tiles.
+ * Each tile is computed with cellularAutomataRegion on the pool, so the
+ * output is bit-identical to cellularAutomataInto.
+ * @param currentMap The map in its current state.
+ * @param newMap Destination for the next generation (must not alias currentMap).
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @param pool Thread pool that runs the tiles.
+ * @param tileRows Height of each tile.
+ * @param tileCols Width of each tile.
+ */
+template <typename MapT>
+void cellularAutomataParallel(const MapT& currentMap, MapT& newMap, int W, int H, int R, double U,
+                              ThreadPool& pool, int tileRows = 64, int tileCols = 256) {
+    tileRows = std::max(1, tileRows);
+    tileCols = std::max(1, tileCols);
+    const int tilesY = (H + tileRows - 1) / tileRows;
+    const int tilesX = (W + tileCols - 1) / tileCols;
+
+    pool.parallelFor(tilesY * tilesX, [&](int tile) {
+        const int rowBegin = (tile / tilesX) * tileRows;
+        const int colBegin = (tile % tilesX) * tileCols;
+        cellularAutomataRegion(currentMap, newMap, W, H, R, U,
+                               rowBegin, std::min(H, rowBegin + tileRows),
+                               colBegin, std::min(W, colBegin + tileCols));
+    });
+}
+
+/**
+ * @brief Advances several Cellular Automata generations per tile (temporal blocking).
+ * Each tile is loaded together with an R * generations halo into two small
+ * scratch grids and stepped there generation after generation, shrinking the
+ * computed area by R each time, so the map is streamed through memory once
+ * instead of once per generation. The result equals applying
+ * cellularAutomataInto `generations` times.
+ * @param currentMap The map in its current state.
+ * @param newMap Destination for the final generation (must not alias currentMap).
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
+ * @param U Threshold to decide if the current cell becomes 1 or 0.
+ * @param generations Number of generations fused per tile.
+ * @param tileRows Height of each tile.
+ * @param tileCols Width of each tile.
+ * @param pool Optional thread pool; tiles are independent and run in parallel.
+ */
+template <typename MapT>
+void cellularAutomataFused(const MapT& currentMap, MapT& newMap, int W, int H, int R, double U,
+                           int generations, int tileRows = 64, int tileCols = 64,
+                           ThreadPool* pool = nullptr) {
+    tileRows = std::max(1, tileRows);
+    tileCols = std::max(1, tileCols);
+    generations = std::max(0, generations);
+    const int halo = R * generations;
+    const int tilesY = (H + tileRows - 1) / tileRows;
+    const int tilesX = (W + tileCols - 1) / tileCols;
+
+    auto runTile = [&](int tile) {
+        const int r0 = (tile / tilesX) * tileRows;
+        const int r1 = std::min(H, r0 + tileRows);
+        const int c0 = (tile % tilesX) * tileCols;
+        const int c1 = std::min(W, c0 + tileCols);
+
+        // Región local: tile + halo, recortada a los bordes del mapa
+        const int lr0 = std::max(0, r0 - halo);
+        const int lr1 = std::min(H, r1 + halo);
+        const int lc0 = std::max(0, c0 - halo);
+        const int lc1 = std::min(W, c1 + halo);
+        const int localH = lr1 - lr0;
+        const int localW = lc1 - lc0;
+
+        Grid<int> front(localW, localH);
+        Grid<int> back(localW, localH);
+        for (int i = 0; i < localH; ++i) {
+            for (int j = 0; j < localW; ++j) {
+                front[i][j] = currentMap[lr0 + i][lc0 + j];
+            }
+        }
+
+        for (int g = 1; g <= generations; ++g) {
+            // Tras g generaciones solo es válida la zona a R * (generations - g) del tile
+            const int margin = R * (generations - g);
+            cellularAutomataRegion(front, back, localW, localH, R, U,
+                                   std::max(lr0, r0 - margin) - lr0, std::min(lr1, r1 + margin) - lr0,
+                                   std::max(lc0, c0 - margin) - lc0, std::min(lc1, c1 + margin) - lc0);
+            std::swap(front, back);
+        }
+
+        for (int i = r0; i < r1; ++i) {
+            for (int j = c0; j < c1; ++j) {
+                newMap[i][j] = front[i - lr0][j - lc0];
+            }
+        }
+    };
+
+    if (pool != nullptr) {
+        pool->parallelFor(tilesY * tilesX, runTile);
+    } else {
+        for (int tile = 0; tile < tilesY * tilesX; ++tile) {
+            runTile(tile);
+        }
+    }
+}
+
+/**
+ * @brief Scratch storage for cellularAutomataIncremental, reusable across steps.
+ * Keeping one instance alive makes repeated incremental steps allocation-free
+ * once the vectors have grown to their working size.
+ */
+struct IncrementalBuffers {
+    std::vector<long long> affected;             // Celdas a reevaluar (i * W + j)
+    std::vector<char> newValues;                 // Nuevo valor de cada celda de affected
+    std::vector<std::pair<int, int>> changed;    // Cambios combinados (ver la sobrecarga con CarveLog)
+};
+
+/**
+ * @brief Cellular Automata step that only re-evaluates cells near a list of changed cells.
+ * A cell can only change if its window of radius R contains a changed cell, so
+ * only those cells are recomputed. Their new values are all computed before any
+ * is written, and map is updated in place. The cost is proportional to the
+ * number of changed cells times (2R+1)^2, independent of W and H.
+ *
+ * Precondition: there is an earlier map P such that map differs from P only
+ * at cells listed in changed, and one step of P agrees with map at every
+ * unlisted cell. This holds for a stable map followed by edits (changed = the
+ * edited cells), and for the result of a previous step followed by edits
+ * (changed = that step's flips plus the edited cells). Under it, the result
+ * is exactly cellularAutomata(map). Listing extra or repeated cells is harmless.
+ * @param map The map to advance (updated in place).
+ * @param W Width of the map.
+ * @param H Height of the map.
+ * @param R Radius of the neighbor window.
+ * @param U Threshold to decide if a cell becomes 1 or 0.
+ * @param changed (row, column) of the cells that differ from P.
+ * @param flips Cleared, then receives (row, column) of the cells that flipped (must not alias changed).
+ * @param buffers Scratch storage.
+ */
+template <typename MapT>
+void cellularAutomataIncremental(MapT& map, int W, int H, int R, double U,
+                                 const std::vector<std::pair<int, int>>& changed,
+                                 std::vector<std::pair<int, int>>& flips, IncrementalBuffers& buffers) {
+    // Celdas cuya ventana contiene alguna celda cambiada, sin repetir
+    std::vector<long long>& affected = buffers.affected;
+    affected.clear();
+    for (const auto& cell : changed) {
+        for (int i = std::max(0, cell.first - R); i <= std::min(H - 1, cell.first + R); ++i) {
+            for (int j = std::max(0, cell.second - R); j <= std::min(W - 1, cell.second + R); ++j) {
+                affected.push_back(static_cast<long long>(i) * W + j);
+            }
+        }
+    }
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+    const int threshold = minCountAbove(R, U);
+    std::vector<char>& newValues = buffers.newValues;
+    newValues.resize(affected.size());
+    for (std::size_t k = 0; k < affected.size(); ++k) {
+        const int i = static_cast<int>(affected[k] / W);
+        const int j = static_cast<int>(affected[k] % W);
+        int countOnes = 0;
+        for (int ni = std::max(0, i - R); ni <= std::min(H - 1, i + R); ++ni) {
+            for (int nj = std::max(0, j - R); nj <= std::min(W - 1, j + R); ++nj) {
+                countOnes += map[ni][nj];
+            }
+        }
+        newValues[k] = (countOnes >= threshold) ? 1 : 0;
+    }
+    flips.clear();
+    for (std::size_t k = 0; k < affected.size(); ++k) {
+        const int i = static_cast<int>(affected[k] / W);
+        const int j = static_cast<int>(affected[k] % W);
+        if (map[i][j] != newValues[k]) {
+            map[i][j] = newValues[k];
+            flips.emplace_back(i, j);
+        }
+    }
+}
+
+/**
+ * @brief cellularAutomataIncremental with temporary buffers.
+ * @return (row, column) of the cells that flipped in this step.
+ */
+template <typename MapT>
+std::vector<std::pair<int, int>> cellularAutomataIncremental(MapT& map, int W, int H, int R, double U,
+                                                             const std::vector<std::pair<int, int>>& changed) {
+    IncrementalBuffers buffers;
+    std::vector<std::pair<int, int>> flips;
+    cellularAutomataIncremental(map, W, H, R, U, changed, flips, buffers);
+    return flips;
+}
+
+/**
+ * @brief Appends (row, column) of every cell where before and after differ.
+ * Gives the flips of a full step so later steps can continue incrementally.
+ */
+template <typename MapT>
+void appendChangedCells(const MapT& before, const MapT& after, int W, int H,
+                        std::vector<std::pair<int, int>>& out) {
+    for (int i = 0; i < H; ++i) {
+        for (int j = 0; j < W; ++j) {
+            if (before[i][j] != after[i][j]) {
+                out.emplace_back(i, j);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Cellular Automata that only re-evaluates tiles near last generation's changes.
+ * The map is split into square tiles and each tile remembers whether any of
+ * its cells flipped in the previous generation. A tile is recomputed only if a
+ * changed tile lies within R cells of it; every other tile is provably stable
+ * and is skipped without even being copied, because the back buffer already
+ * holds the same cells. Converged regions therefore cost nothing.
+ */
+class ActiveRegionAutomaton {
+public:
+    /**
+     * @param initial The starting map.
+     * @param W Width of the map.
+     * @param H Height of the map.
+     * @param R Radius of the neighbor window.
+     * @param U Threshold to decide if a cell becomes 1 or 0.
+     * @param tileSize Side of the square tiles used to track changes.
+     */
+    ActiveRegionAutomaton(const Map& initial, int W, int H, int R, double U, int tileSize = 32)
+        : W_(W), H_(H), R_(R), U_(U), tileSize_(std::max(1, tileSize)),
+          tilesX_((W + std::max(1, tileSize) - 1) / std::max(1, tileSize)),
+          tilesY_((H + std::max(1, tileSize) - 1) / std::max(1, tileSize)),
+          front_(initial), back_(initial),
+          changed_(static_cast<std::size_t>(tilesX_) * tilesY_, 1),
+          nextChanged_(changed_.size(), 0),
+          active_(changed_.size(), 0) {}
+
+    const Map& map() const { return front_; }
+    int lastEvaluatedTiles() const { return evaluatedTiles_; }
+
+    /**
+     * @brief Edits a cell from outside (e.g. the drunk agent) and marks its tile dirty.
+     */
+    void setCell(int i, int j, int value) {
+        if (front_[i][j] != value) {
+            front_[i][j] = value;
+            changed_[static_cast<std::size_t>(i / tileSize_) * tilesX_ + j / tileSize_] = 1;
+        }
+    }
+
+    /**
+     * @brief Advances one generation.
+     * @return The number of cells that flipped.
+     */
+    long long step() {
+        // Tiles a distancia <= R de un tile que cambió deben recalcularse
+        const int reach = (R_ + tileSize_ - 1) / tileSize_;
+        std::fill(active_.begin(), active_.end(), 0);
+        for (int ty = 0; ty < tilesY_; ++ty) {
+            for (int tx = 0; tx < tilesX_; ++tx) {
+                if (!changed_[static_cast<std::size_t>(ty) * tilesX_ + tx]) {
+                    continue;
+                }
+                for (int ny = std::max(0, ty - reach); ny <= std::min(tilesY_ - 1, ty + reach); ++ny) {
+                    for (int nx = std::max(0, tx - reach); nx <= std::min(tilesX_ - 1, tx + reach); ++nx) {
+                        active_[static_cast<std::size_t>(ny) * tilesX_ + nx] = 1;
+                    }
+                }
+            }
+        }
+
+        long long flipped = 0;
+        evaluatedTiles_ = 0;
+        std::fill(nextChanged_.begin(), nextChanged_.end(), 0);
+        for (int ty = 0; ty < tilesY_; ++ty) {
+            for (int tx = 0; tx < tilesX_; ++tx) {
+                const std::size_t tile = static_cast<std::size_t>(ty) * tilesX_ + tx;
+                if (!active_[tile]) {
+                    continue; // back_ ya es igual a front_ en este tile
+                }
+                ++evaluatedTiles_;
+                const int r0 = ty * tileSize_;
+                const int r1 = std::min(H_, r0 + tileSize_);
+                const int c0 = tx * tileSize_;
+                const int c1 = std::min(W_, c0 + tileSize_);
+                cellularAutomataRegion(front_, back_, W_, H_, R_, U_, r0, r1, c0, c1);
+
+                long long tileFlips = 0;
+                for (int i = r0; i < r1; ++i) {
+                    for (int j = c0; j < c1; ++j) {
+                        tileFlips += (back_[i][j] != front_[i][j]);
+                    }
+                }
+                nextChanged_[tile] = (tileFlips > 0);
+                flipped += tileFlips;
+            }
+        }
+
+        front_.swap(back_);
+        changed_.swap(nextChanged_);
+        return flipped;
+    }
+
+private:
+    int W_;
+    int H_;
+    int R_;
+    double U_;
+    int tileSize_;
+    int tilesX_;
+    int tilesY_;
+    Map front_;
+    Map back_;
+    std::vector<char> changed_;     // Tiles con celdas que cambiaron en la última generación
+    std::vector<char> nextChanged_;
+    std::vector<char> active_;      // Tiles a recalcular en esta generación
+    int evaluatedTiles_ = 0;
+};
+
+/**
+ * @brief Cellular Automata that keeps every cell's neighbor count up to date.
+ * counts holds, for each cell, the number of 1s in its clipped (2R+1)^2
+ * window. When a cell flips, by the rule or through setCell, the counts of
+ * its window are adjusted and those cells become candidates for the next
+ * generation. A generation only looks at the candidates, so its cost is
+ * proportional to the number of flips times (2R+1)^2 rather than to W*H.
+ * Results are identical to cellularAutomata.
+ */
+class CountingAutomaton {
+public:
+    /**
+     * @param initial The starting map.
+     * @param W Width of the map.
+     * @param H Height of the map.
+     * @param R Radius of the neighbor window.
+     * @param U Threshold to decide if a cell becomes 1 or 0.
+     */
+    CountingAutomaton(const Map& initial, int W, int H, int R, double U)
+        : W_(W), H_(H), R_(R), threshold_(minCountAbove(R, U)), map_(initial),
+          counts_(static_cast<std::size_t>(W) * H, 0),
+          isCandidate_(counts_.size(), 1) {
+        // Conteos iniciales con sumas deslizantes separables
+        std::vector<int> colCount(W, 0);
+        for (int r = 0; r <= std::min(H - 1, R); ++r) {
+            addRowWindowSums(map_[r], W, R, +1, colCount);
+        }
+        for (int i = 0; i < H; ++i) {
+            std::copy(colCount.begin(), colCount.end(), counts_.begin() + static_cast<std::ptrdiff_t>(i) * W);
+            if (i + R + 1 < H) {
+                addRowWindowSums(map_[i + R + 1], W, R, +1, colCount);
+            }
+            if (i - R >= 0) {
+                addRowWindowSums(map_[i - R], W, R, -1, colCount);
+            }
+        }
+        // Al principio ninguna celda tiene por qué cumplir la regla: todas son candidatas
+        candidates_.resize(counts_.size());
+        for (std::size_t k = 0; k < candidates_.size(); ++k) {
+            candidates_[k] = static_cast<int>(k);
+        }
+    }
+
+    const Map& map() const { return map_; }
+    int count(int i, int j) const { return counts_[static_cast<std::size_t>(i) * W_ + j]; }
+    std::size_t candidateCount() const { return candidates_.size(); }
+
+    /**
+     * @brief Edits a cell from outside (e.g. the drunk agent) and updates the counts around it.
+     */
+    void setCell(int i, int j, int value) {
+        if (map_[i][j] != value) {
+            applyFlip(i, j, value);
+        }
+    }
+
+    /**
+     * @brief Advances one generation.
+     * Decisions are taken for all candidates before any flip is applied, so
+     * the update is synchronous like cellularAutomata.
+     * @return The number of cells that flipped.
+     */
+    long long step() {
+        flips_.clear();
+        for (int index : candidates_) {
+            isCandidate_[index] = 0;
+            const int i = index / W_;
+            const int j = index % W_;
+            const int value = (counts_[index] >= threshold_) ? 1 : 0;
+            if (map_[i][j] != value) {
+                flips_.push_back(index);
+            }
+        }
+        candidates_.clear();
+        for (int index : flips_) {
+            const int i = index / W_;
+            const int j = index % W_;
+            applyFlip(i, j, map_[i][j] ? 0 : 1);
+        }
+        return static_cast<long long>(flips_.size());
+    }
+
+private:
+    void applyFlip(int i, int j, int value) {
+        const int delta = value - map_[i][j];
+        map_[i][j] = value;
+        for (int ni = std::max(0, i - R_); ni <= std::min(H_ - 1, i + R_); ++ni) {
+            for (int nj = std::max(0, j - R_); nj <= std::min(W_ - 1, j + R_); ++nj) {
+                const int index = ni * W_ + nj;
+                counts_[index] += delta;
+                if (!isCandidate_[index]) {
+                    isCandidate_[index] = 1;
+                    candidates_.push_back(index);
+                }
+            }
+        }
+    }
+
+    int W_;
+    int H_;
+    int R_;
+    int threshold_;
+    Map map_;
+    std::vector<int> counts_;        // Unos en la ventana de cada celda
+    std::vector<char> isCandidate_;  // La celda ya está en candidates_
+    std::vector<int> candidates_;    // Celdas cuyo conteo cambió desde que se evaluaron
+    std::vector<int> flips_;
+};
+
+/**
+ * @brief HashLife-style engine: hashed, canonicalized quadtree with memoized futures.
+ * The map is stored as a quadtree whose identical sub-squares share a single
+ * node, and the future of each node (its center half advanced 2^j
+ * generations) is computed once and cached. Repeated structure and uniform
+ * space are therefore only simulated once, and a run of N generations takes
+ * O(log N) jumps. Cells outside the map are a third, static "wall" state that
+ * counts as 0, which reproduces the clipped borders of cellularAutomata
+ * exactly. Caches grow with the number of distinct nodes; call clear() to
+ * drop them between unrelated maps.
+ */
+class HashLifeEngine {
+public:
+    /**
+     * @param R Radius of the neighbor window.
+     * @param U Threshold to decide if a cell becomes 1 or 0.
+     */
+    HashLifeEngine(int R, double U) : R_(R), threshold_(minCountAbove(R, U)) {
+        // Las hojas deben medir al menos 2R para poder avanzar su centro una generación
+        leafLevel_ = 3;
+        while ((1 << leafLevel_) < 2 * R_) {
+            ++leafLevel_;
+        }
+        leafSide_ = 1 << leafLevel_;
+    }
+
+    /**
+     * @brief Advances a map by the given number of generations.
+     * @param map The map in its current state.
+     * @param W Width of the map.
+     * @param H Height of the map.
+     * @param generations Number of generations to run.
+     * @return The map after `generations` applications of the rule.
+     */
+    Map run(const Map& map, int W, int H, long long generations) {
+        int level = leafLevel_;
+        while ((1 << level) < std::max(W, H)) {
+            ++level;
+        }
+        std::uint32_t root = build(map, W, H, level, 0, 0);
+
+        // Con la raíz limitada a maxLevel_, los desplazamientos caben en long long y cada salto
+        // avanza como mucho 2^(maxLevel_ - hoja) generaciones: N sigue costando O(log N) saltos
+        const int maxJump = maxLevel_ - leafLevel_;
+        while (generations > 0) {
+            int j = 0;
+            while (j < maxJump && (2LL << j) <= generations) {
+                ++j;
+            }
+            // Un nodo de nivel k centrado en la raíz puede avanzar 2^(k - hoja - 1) generaciones;
+            // la raíz nunca puede quedarse en una hoja, expand necesita al menos un nivel por encima
+            while (level - leafLevel_ < std::max(j, 1)) {
+                const std::uint32_t wall = wallNode(level);
+                root = node(root, wall, wall, wall);
+                ++level;
+            }
+            root = result(expand(root), j);
+            generations -= 1LL << j;
+        }
+
+        Map out(H, std::vector<int>(W, 0));
+        dump(root, 0, 0, out, W, H);
+        return out;
+    }
+
+    std::size_t nodeCount() const { return nodes_.size(); }
+
+    /**
+     * @brief Drops every cached node and result.
+     */
+    void clear() {
+        nodes_.clear();
+        leafCells_.clear();
+        leafIndex_.clear();
+        nodeIndex_.clear();
+        results_.clear();
+        walls_.clear();
+    }
+
+private:
+    enum : std::uint8_t { Dead = 0, Alive = 1, Wall = 2 };
+
+    struct Node {
+        std::uint32_t nw, ne, sw, se; // En una hoja, nw es el índice de sus celdas
+        int level;
+    };
+
+    struct NodeKey {
+        std::uint32_t nw, ne, sw, se;
+        bool operator==(const NodeKey& o) const { return nw == o.nw && ne == o.ne && sw == o.sw && se == o.se; }
+    };
+
+    struct NodeKeyHash {
+        std::size_t operator()(const NodeKey& k) const {
+            std::uint64_t h = (static_cast<std::uint64_t>(k.nw) << 32 | k.ne) * 0x9e3779b97f4a7c15ULL;
+            h ^= (static_cast<std::uint64_t>(k.sw) << 32 | k.se) + 0x7f4a7c159e3779b9ULL + (h << 6) + (h >> 2);
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+    const std::uint8_t* cells(std::uint32_t leaf) const {
+        return leafCells_.data() + static_cast<std::size_t>(nodes_[leaf].nw) * leafSide_ * leafSide_;
+    }
+
+    std::uint32_t leaf(const std::uint8_t* data) {
+        const std::size_t size = static_cast<std::size_t>(leafSide_) * leafSide_;
+        std::string key(reinterpret_cast<const char*>(data), size);
+        auto it = leafIndex_.find(key);
+        if (it != leafIndex_.end()) {
+            return it->second;
+        }
+        const std::uint32_t slot = static_cast<std::uint32_t>(leafCells_.size() / size);
+        leafCells_.insert(leafCells_.end(), data, data + size);
+        const std::uint32_t id = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.push_back({slot, 0, 0, 0, leafLevel_});
+        leafIndex_.emplace(std::move(key), id);
+        return id;
+    }
+
+    std::uint32_t node(std::uint32_t nw, std::uint32_t ne, std::uint32_t sw, std::uint32_t se) {
+        const NodeKey key{nw, ne, sw, se};
+        auto it = nodeIndex_.find(key);
+        if (it != nodeIndex_.end()) {
+            return it->second;
+        }
+        const std::uint32_t id = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.push_back({nw, ne, sw, se, nodes_[nw].level + 1});
+        nodeIndex_.emplace(key, id);
+        return id;
+    }
+
+    std::uint32_t wallNode(int level) {
+        if (walls_.empty()) {
+            std::vector<std::uint8_t> data(static_cast<std::size_t>(leafSide_) * leafSide_, Wall);
+            walls_.push_back(leaf(data.data()));
+        }
+        while (static_cast<int>(walls_.size()) <= level - leafLevel_) {
+            const std::uint32_t w = walls_.back();
+            walls_.push_back(node(w, w, w, w));
+        }
+        return walls_[level - leafLevel_];
+    }
+
+    // Construye el cuadrante de lado 2^level con esquina (row0, col0)
+    std::uint32_t build(const Map& map, int W, int H, int level, long long row0, long long col0) {
+        if (row0 >= H || col0 >= W) {
+            return wallNode(level);
+        }
+        if (level == leafLevel_) {
+            std::vector<std::uint8_t> data(static_cast<std::size_t>(leafSide_) * leafSide_, Wall);
+            for (int i = 0; i < leafSide_ && row0 + i < H; ++i) {
+                for (int j = 0; j < leafSide_ && col0 + j < W; ++j) {
+                    data[i * leafSide_ + j] = map[row0 + i][col0 + j] ? Alive : Dead;
+                }
+            }
+            return leaf(data.data());
+        }
+        const long long half = 1LL << (level - 1);
+        return node(build(map, W, H, level - 1, row0, col0),
+                    build(map, W, H, level - 1, row0, col0 + half),
+                    build(map, W, H, level - 1, row0 + half, col0),
+                    build(map, W, H, level - 1, row0 + half, col0 + half));
+    }
+
+    void dump(std::uint32_t n, long long row0, long long col0, Map& out, int W, int H) const {
+        if (row0 >= H || col0 >= W) {
+            return;
+        }
+        const Node& nd = nodes_[n];
+        if (nd.level == leafLevel_) {
+            const std::uint8_t* data = cells(n);
+            for (int i = 0; i < leafSide_ && row0 + i < H; ++i) {
+                for (int j = 0; j < leafSide_ && col0 + j < W; ++j) {
+                    out[row0 + i][col0 + j] = (data[i * leafSide_ + j] == Alive) ? 1 : 0;
+                }
+            }
+            return;
+        }
+        const long long half = 1LL << (nd.level - 1);
+        dump(nd.nw, row0, col0, out, W, H);
+        dump(nd.ne, row0, col0 + half, out, W, H);
+        dump(nd.sw, row0 + half, col0, out, W, H);
+        dump(nd.se, row0 + half, col0 + half, out, W, H);
+    }
+
+    // Nodo de un nivel más con n en el centro y muro alrededor
+    std::uint32_t expand(std::uint32_t n) {
+        const Node nd = nodes_[n];
+        const std::uint32_t wall = wallNode(nd.level - 1);
+        return node(node(wall, wall, wall, nd.nw), node(wall, wall, nd.ne, wall),
+                    node(wall, nd.sw, wall, wall), node(nd.se, wall, wall, wall));
+    }
+
+    // Mitad central de n, sin avanzar en el tiempo
+    std::uint32_t centerNode(std::uint32_t n) {
+        const Node nd = nodes_[n];
+        if (nd.level - 1 > leafLevel_) {
+            return node(nodes_[nd.nw].se, nodes_[nd.ne].sw, nodes_[nd.sw].ne, nodes_[nd.se].nw);
+        }
+        const int half = leafSide_ / 2;
+        std::vector<std::uint8_t> data(static_cast<std::size_t>(leafSide_) * leafSide_);
+        const std::uint32_t quads[4] = {nd.nw, nd.ne, nd.sw, nd.se};
+        for (int q = 0; q < 4; ++q) {
+            const std::uint8_t* src = cells(quads[q]);
+            const int srcRow = (q < 2) ? half : 0;
+            const int srcCol = (q % 2 == 0) ? half : 0;
+            for (int i = 0; i < half; ++i) {
+                for (int j = 0; j < half; ++j) {
+                    data[(i + (q / 2) * half) * leafSide_ + j + (q % 2) * half] =
+                        src[(srcRow + i) * leafSide_ + srcCol + j];
+                }
+            }
+        }
+        return leaf(data.data());
+    }
+
+    // Nodo de nivel leafLevel_ + 1: su centro avanza una generación por fuerza bruta
+    std::uint32_t baseResult(std::uint32_t n) {
+        const Node nd = nodes_[n];
+        const int side = 2 * leafSide_;
+        std::vector<std::uint8_t> grid(static_cast<std::size_t>(side) * side);
+        const std::uint32_t quads[4] = {nd.nw, nd.ne, nd.sw, nd.se};
+        for (int q = 0; q < 4; ++q) {
+            const std::uint8_t* src = cells(quads[q]);
+            for (int i = 0; i < leafSide_; ++i) {
+                std::copy(src + i * leafSide_, src + (i + 1) * leafSide_,
+                          grid.begin() + (i + (q / 2) * leafSide_) * side + (q % 2) * leafSide_);
+            }
+        }
+
+        const int half = leafSide_ / 2;
+        std::vector<std::uint8_t> data(static_cast<std::size_t>(leafSide_) * leafSide_);
+        for (int i = 0; i < leafSide_; ++i) {
+            for (int j = 0; j < leafSide_; ++j) {
+                const int gi = i + half;
+                const int gj = j + half;
+                std::uint8_t next = Wall;
+                if (grid[gi * side + gj] != Wall) {
+                    int countOnes = 0;
+                    for (int di = -R_; di <= R_; ++di) {
+                        for (int dj = -R_; dj <= R_; ++dj) {
+                            countOnes += (grid[(gi + di) * side + gj + dj] == Alive);
+                        }
+                    }
+                    next = (countOnes >= threshold_) ? Alive : Dead;
+                }
+                data[i * leafSide_ + j] = next;
+            }
+        }
+        return leaf(data.data());
+    }
+
+    // Mitad central de n avanzada 2^j generaciones (0 <= j <= nivel - leafLevel_ - 1)
+    std::uint32_t result(std::uint32_t n, int j) {
+        const std::uint64_t key = static_cast<std::uint64_t>(n) << 8 | static_cast<std::uint64_t>(j);
+        auto it = results_.find(key);
+        if (it != results_.end()) {
+            return it->second;
+        }
+
+        const Node nd = nodes_[n];
+        std::uint32_t out;
+        if (nd.level == leafLevel_ + 1) {
+            out = baseResult(n);
+        } else {
+            const Node nw = nodes_[nd.nw];
+            const Node ne = nodes_[nd.ne];
+            const Node sw = nodes_[nd.sw];
+            const Node se = nodes_[nd.se];
+            // Nueve sub-nodos solapados de nivel - 1
+            std::uint32_t sub[3][3] = {
+                {nd.nw, node(nw.ne, ne.nw, nw.se, ne.sw), nd.ne},
+                {node(nw.sw, nw.se, sw.nw, sw.ne), node(nw.se, ne.sw, sw.ne, se.nw), node(ne.sw, ne.se, se.nw, se.ne)},
+                {nd.sw, node(sw.ne, se.nw, sw.se, se.sw), nd.se},
+            };
+
+            // Máxima velocidad: dos saltos de 2^(j-1); si no, solo un salto de 2^j
+            const bool full = (j == nd.level - leafLevel_ - 1);
+            const int subStep = full ? j - 1 : j;
+            for (auto& row : sub) {
+                for (std::uint32_t& s : row) {
+                    s = full ? result(s, subStep) : centerNode(s);
+                }
+            }
+            out = node(result(node(sub[0][0], sub[0][1], sub[1][0], sub[1][1]), subStep),
+                       result(node(sub[0][1], sub[0][2], sub[1][1], sub[1][2]), subStep),
+                       result(node(sub[1][0], sub[1][1], sub[2][0], sub[2][1]), subStep),
+                       result(node(sub[1][1], sub[1][2], sub[2][1], sub[2][2]), subStep));
+        }
+        results_.emplace(key, out);
+        return out;
+    }
+
+    static constexpr int maxLevel_ = 62; // 2^(nivel - 1) debe caber en long long
+    int R_;
+    int threshold_;
+    int leafLevel_;
+    int leafSide_;
+    std::vector<Node> nodes_;
+    std::vector<std::uint8_t> leafCells_;
+    std::unordered_map<std::string, std::uint32_t> leafIndex_;
+    std::unordered_map<NodeKey, std::uint32_t, NodeKeyHash> nodeIndex_;
+    std::unordered_map<std::uint64_t, std::uint32_t> results_;
+    std::vector<std::uint32_t> walls_; // walls_[k] = nodo de muro de nivel leafLevel_ + k
+};
+
+/**
+ * @brief Advances a splitmix64 state and returns the next output.
+ * Used to expand a single 64-bit seed into the state of the engines below.
+ */
+inline std::uint64_t splitMix64(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+inline std::uint64_t rotl64(std::uint64_t x, int k) { return (x << k) | (x >> ((64 - k) & 63)); }
+inline std::uint64_t rotr64(std::uint64_t x, int k) { return (x >> k) | (x << ((64 - k) & 63)); }
+
+/**
+ * @brief xoshiro256** generator (Blackman & Vigna): 32 bytes of state, a few cycles per draw.
+ * Like every engine here it is a UniformRandomBitGenerator, so it works with
+ * the std:: distributions and can be passed wherever a generator is taken.
+ */
+class Xoshiro256StarStar {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type{0}; }
+
+    explicit Xoshiro256StarStar(std::uint64_t seed) {
+        for (std::uint64_t& word : s_) {
+            word = splitMix64(seed);
+        }
+    }
+
+    result_type operator()() {
+        const std::uint64_t result = rotl64(s_[1] * 5, 7) * 9;
+        const std::uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl64(s_[3], 45);
+        return result;
+    }
+
+private:
+    std::uint64_t s_[4];
+};
+
+#ifdef __SIZEOF_INT128__
+/**
+ * @brief PCG64 generator (O'Neill, XSL-RR 128/64 variant, as in NumPy).
+ * @param seed Initial state.
+ * @param stream Selects one of 2^127 independent sequences.
+ */
+class Pcg64 {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type{0}; }
+
+    explicit Pcg64(std::uint64_t seed, std::uint64_t stream = 0) {
+        std::uint64_t sm = seed;
+        const unsigned __int128 initState = (static_cast<unsigned __int128>(splitMix64(sm)) << 64) | splitMix64(sm);
+        increment_ = ((static_cast<unsigned __int128>(stream) << 64 | 0xda3e39cb94b95bdbULL) << 1) | 1u;
+        state_ = 0;
+        step();
+        state_ += initState;
+        step();
+    }
+
+    result_type operator()() {
+        step();
+        const std::uint64_t high = static_cast<std::uint64_t>(state_ >> 64);
+        const std::uint64_t low = static_cast<std::uint64_t>(state_);
+        return rotr64(high ^ low, static_cast<int>(high >> 58));
+    }
+
+private:
+    void step() {
+        const unsigned __int128 multiplier =
+            (static_cast<unsigned __int128>(0x2360ed051fc65da4ULL) << 64) | 0x4385df649fccf645ULL;
+        state_ = state_ * multiplier + increment_;
+    }
+
+    unsigned __int128 state_;
+    unsigned __int128 increment_;
+};
+#endif
+
+/**
+ * @brief Philox4x32-10 counter-based generator (Salmon et al., Random123).
+ * Each output block is a keyed bijection of a 128-bit counter, so any stream
+ * or position can be reached directly without generating the ones before.
+ * @param seed Becomes the 64-bit key.
+ * @param stream Upper half of the counter; distinct streams never overlap.
+ */
+class Philox4x32 {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type{0}; }
+
+    explicit Philox4x32(std::uint64_t seed, std::uint64_t stream = 0)
+        : key_{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+          counter_{0, 0, static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)} {}
+
+    result_type operator()() {
+        if (used_ == 2) {
+            refill();
+        }
+        const std::uint64_t out = static_cast<std::uint64_t>(block_[2 * used_]) |
+                                  static_cast<std::uint64_t>(block_[2 * used_ + 1]) << 32;
+        ++used_;
+        return out;
+    }
+
+    /**
+     * @brief Philox4x32-10 bijection of one counter block under a key.
+     */
+    static std::array<std::uint32_t, 4> block(std::array<std::uint32_t, 4> ctr, std::array<std::uint32_t, 2> key) {
+        for (int round = 0; round < 10; ++round) {
+            const std::uint64_t p0 = static_cast<std::uint64_t>(0xD2511F53u) * ctr[0];
+            const std::uint64_t p1 = static_cast<std::uint64_t>(0xCD9E8D57u) * ctr[2];
+            ctr = {static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0], static_cast<std::uint32_t>(p1),
+                   static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1], static_cast<std::uint32_t>(p0)};
+            key[0] += 0x9E3779B9u;
+            key[1] += 0xBB67AE85u;
+        }
+        return ctr;
+    }
+
+private:
+    void refill() {
+        block_ = block(counter_, key_);
+        // Incrementar la mitad baja del contador (64 bits)
+        if (++counter_[0] == 0) {
+            ++counter_[1];
+        }
+        used_ = 0;
+    }
+
+    std::array<std::uint32_t, 2> key_;
+    std::array<std::uint32_t, 4> counter_;
+    std::array<std::uint32_t, 4> block_{};
+    int used_ = 2;
+};
+
+/**
+ * @brief Seed taken from the clock, for runs that do not need to be reproducible.
+ */
+inline std::uint64_t clockSeed() {
+    return static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+}
+
+/**
+ * @brief Drunk Agent walk, independent of how the carved cells are stored.
+ * Calls carver.cell(x, y) for every corridor cell and
+ * carver.rect(startX, endX, startY, endY) (inclusive bounds) for every room;
+ * the walk itself only depends on W, H, the parameters and gen.
+ * Parameters are the same as in drunkAgent.
+ * @param carver Receives the carved cells.
+ * @param gen Random number generator driving the agent (any UniformRandomBitGenerator).
+ */
+template <typename Carver, typename Rng>
+void drunkAgentWalk(Carver& carver, int W, int H, int J, int I, int roomSizeX, int roomSizeY,
+                    double probGenerateRoom, double probIncreaseRoom,
+                    double probChangeDirection, double probIncreaseChange,
+                    int& agentX, int& agentY, Rng& gen) {
+    std::uniform_int_distribution<> distDirection(0, 3);
+    std::uniform_real_distribution<> distProb(0.0, 1.0);
+
+    static constexpr int directions[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    double currentProbRoom = probGenerateRoom;
+    double currentProbChange = probChangeDirection; // Probabilidad actual para cambiar dirección
+
+    for (int walk = 0; walk < J; ++walk) {
+        int currentDirection = distDirection(gen);
+        for (int step = 0; step < I; ++step) {
+            // Marcar la posición actual como pasillo (1)
+            carver.cell(agentX, agentY);
+
+            // Generar habitación
+            if (distProb(gen) < currentProbRoom) {
+                int halfX = roomSizeX / 2;
+                int halfY = roomSizeY / 2;
+                int startX = std::max(0, agentX - halfX);
+                int endX = std::min(H - 1, agentX + halfX);
+                int startY = std::max(0, agentY - halfY);
+                int endY = std::min(W - 1, agentY + halfY);
+                carver.rect(startX, endX, startY, endY);
+                currentProbRoom = probGenerateRoom;
+            } else {
+                currentProbRoom += probIncreaseRoom;
+            }
+
+            // Decidir si cambiar de dirección
+            if (distProb(gen) < currentProbChange) {
+                currentDirection = distDirection(gen);
+                currentProbChange = probChangeDirection; // Reiniciar probabilidad
+            } else {
+                currentProbChange += probIncreaseChange; // Aumentar probabilidad
+            }
+
+            // Calcular el siguiente movimiento
+            int dx = directions[currentDirection][0];
+            int dy = directions[currentDirection][1];
+            int nextX = agentX + dx;
+            int nextY = agentY + dy;
+
+            // Verificar límites
+            if (nextX >= 0 && nextX < H && nextY >= 0 && nextY < W) {
+                agentX = nextX;
+                agentY = nextY;
+            } else {
+                currentDirection = distDirection(gen);
+                currentProbChange = probChangeDirection; // Reiniciar probabilidad al chocar con el borde
+            }
+        }
+    }
+}
+
+/**
+ * @brief Samples how many failed trials precede an event whose probability ramps up linearly.
+ * Trial k (k = 0, 1, ...) succeeds with probability min(1, base + k * increase),
+ * which is exactly how drunkAgent grows probGenerateRoom and probChangeDirection
+ * until they fire. The survival function S(k) = P(no event in the first k trials)
+ * is tabulated once, so a sample is one uniform draw and a binary search instead
+ * of one draw per trial.
+ */
+class RampWaitSampler {
+public:
+    /**
+     * @param base Success probability of the first trial.
+     * @param increase Amount added to the probability after every failure.
+     * @param limit Samples are clamped to this value (callers pass the number of steps left).
+     */
+    RampWaitSampler(double base, double increase, long long limit)
+        : base_(base), increase_(increase), limit_(limit) {
+        if (increase_ == 0.0) {
+            return; // Geométrica: forma cerrada
+        }
+        const long long maxTable = std::min<long long>(limit_, 1 << 16);
+        survival_.push_back(1.0);
+        for (long long k = 0; k < maxTable && survival_.back() > 0.0; ++k) {
+            survival_.push_back(survival_.back() * (1.0 - hazard(k)));
+        }
+    }
+
+    /**
+     * @brief Number of failures before the next event, at most limit.
+     */
+    template <typename Rng>
+    long long operator()(Rng& gen) const {
+        std::uniform_real_distribution<> distProb(0.0, 1.0);
+        const double u = distProb(gen);
+        if (increase_ == 0.0) {
+            if (base_ >= 1.0) {
+                return 0;
+            }
+            if (base_ <= 0.0) {
+                return limit_;
+            }
+            const double k = std::floor(std::log1p(-u) / std::log1p(-base_));
+            return (k >= static_cast<double>(limit_)) ? limit_ : static_cast<long long>(k);
+        }
+        // K = k  <=>  S(k + 1) <= u < S(k)
+        auto it = std::partition_point(survival_.begin() + 1, survival_.end(), [u](double s) { return s > u; });
+        if (it != survival_.end()) {
+            return static_cast<long long>(it - survival_.begin()) - 1;
+        }
+        // Cola fuera de la tabla: seguir ensayo a ensayo
+        for (long long k = static_cast<long long>(survival_.size()) - 1; k < limit_; ++k) {
+            if (distProb(gen) < hazard(k)) {
+                return k;
+            }
+        }
+        return limit_;
+    }
+
+private:
+    double hazard(long long k) const {
+        return std::min(1.0, std::max(0.0, base_ + static_cast<double>(k) * increase_));
+    }
+
+    double base_;
+    double increase_;
+    long long limit_;
+    std::vector<double> survival_;
+};
+
+/**
+ * @brief Event-driven version of drunkAgentWalk.
+ * Rather than drawing two probabilities per step, it samples with
+ * RampWaitSampler how many steps remain until the next room and the next
+ * direction change. The straight run up to that step (or up to the border)
+ * is carved as one carver.rect segment. The room process, the direction
+ * process and the border bounces follow the same rules as drunkAgentWalk, so
+ * the walks have the same distribution. They are not identical for the same
+ * seed, because the generator is consumed differently.
+ * Parameters and carver interface are the same as in drunkAgentWalk.
+ */
+template <typename Carver, typename Rng>
+void drunkAgentWalkSkipping(Carver& carver, int W, int H, int J, int I, int roomSizeX, int roomSizeY,
+                            double probGenerateRoom, double probIncreaseRoom,
+                            double probChangeDirection, double probIncreaseChange,
+                            int& agentX, int& agentY, Rng& gen) {
+    if (J <= 0 || I <= 0) {
+        return;
+    }
+    std::uniform_int_distribution<> distDirection(0, 3);
+    static constexpr int directions[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+    // Ningún evento puede ocurrir más allá del último paso de la llamada
+    const long long totalSteps = static_cast<long long>(J) * I;
+    const RampWaitSampler roomWait(probGenerateRoom, probIncreaseRoom, totalSteps);
+    const RampWaitSampler changeWait(probChangeDirection, probIncreaseChange, totalSteps);
+
+    // Pasos que faltan hasta el paso en que ocurre cada evento (0 = en el paso actual)
+    long long roomIn = roomWait(gen);
+    long long changeIn = changeWait(gen);
+
+    for (int walk = 0; walk < J; ++walk) {
+        int currentDirection = distDirection(gen);
+        int step = 0;
+        while (step < I) {
+            const int dx = directions[currentDirection][0];
+            const int dy = directions[currentDirection][1];
+            const int wallIn = (dx < 0) ? agentX : (dx > 0) ? H - 1 - agentX : (dy < 0) ? agentY : W - 1 - agentY;
+
+            // Pasos rectos sin eventos, más el paso del evento si cae dentro de la caminata
+            const long long plain = std::min({roomIn, changeIn, static_cast<long long>(wallIn),
+                                              static_cast<long long>(I - step)});
+            const int run = static_cast<int>(plain);
+            const bool eventStep = step + run < I;
+            const int length = run + (eventStep ? 1 : 0);
+            const int endX = agentX + dx * (length - 1);
+            const int endY = agentY + dy * (length - 1);
+            carver.rect(std::min(agentX, endX), std::max(agentX, endX), std::min(agentY, endY), std::max(agentY, endY));
+
+            agentX += dx * run;
+            agentY += dy * run;
+            step += run;
+            roomIn -= run;
+            changeIn -= run;
+            if (!eventStep) {
+                break;
+            }
+
+            // Paso con evento: habitación, cambio de dirección y/o choque con el borde
+            if (roomIn == 0) {
+                int halfX = roomSizeX / 2;
+                int halfY = roomSizeY / 2;
+                carver.rect(std::max(0, agentX - halfX), std::min(H - 1, agentX + halfX),
+                            std::max(0, agentY - halfY), std::min(W - 1, agentY + halfY));
+                roomIn = 1 + roomWait(gen);
+            }
+            if (changeIn == 0) {
+                currentDirection = distDirection(gen);
+                changeIn = 1 + changeWait(gen);
+            }
+            const int nextX = agentX + directions[currentDirection][0];
+            const int nextY = agentY + directions[currentDirection][1];
+            if (nextX >= 0 && nextX < H && nextY >= 0 && nextY < W) {
+                agentX = nextX;
+                agentY = nextY;
+            } else {
+                currentDirection = distDirection(gen);
+                changeIn = 1 + changeWait(gen); // El choque reinicia la probabilidad de cambio
+            }
+            ++step;
+            --roomIn;
+            --changeIn;
+        }
+    }
+}
+
+/**
+ * @brief Mask with bits [begin, end) of a 64-bit word set (0 <= begin < end <= 64).
+ */
+inline std::uint64_t bitSpanMask(int begin, int end) {
+    const std::uint64_t high = (end == 64) ? ~std::uint64_t{0} : ((std::uint64_t{1} << end) - 1);
+    return high & (~std::uint64_t{0} << begin);
+}
+
+/**
+ * @brief Sets columns [begin, end) of a packed row with one masked OR per word.
+ */
+inline void setBitSpan(std::uint64_t* row, int begin, int end) {
+    if (begin >= end) {
+        return;
+    }
+    const int firstWord = begin >> 6;
+    const int lastWord = (end - 1) >> 6;
+    if (firstWord == lastWord) {
+        row[firstWord] |= bitSpanMask(begin & 63, ((end - 1) & 63) + 1);
+        return;
+    }
+    row[firstWord] |= bitSpanMask(begin & 63, 64);
+    for (int k = firstWord + 1; k < lastWord; ++k) {
+        row[k] = ~std::uint64_t{0};
+    }
+    row[lastWord] |= bitSpanMask(0, ((end - 1) & 63) + 1);
+}
+
+/**
+ * @brief Fills the inclusive rectangle [startX, endX] x [startY, endY] with 1s, one row span at a time.
+ * Rows are written with std::fill, or std::memset on byte-sized cells, so a
+ * room costs one span per row instead of one store per cell. Works on a Map
+ * or a Grid (rows must be contiguous).
+ */
+template <typename MapT>
+void fillRect(MapT& map, int startX, int endX, int startY, int endY) {
+    if (startY > endY) {
+        return;
+    }
+    for (int x = startX; x <= endX; ++x) {
+        auto* row = &map[x][0];
+        using Cell = std::remove_reference_t<decltype(*row)>;
+        if constexpr (sizeof(Cell) == 1) {
+            std::memset(row + startY, 1, static_cast<std::size_t>(endY - startY + 1));
+        } else {
+            std::fill(row + startY, row + endY + 1, Cell(1));
+        }
     }
-    std::cout << "-------------------" << std::endl;
 }
+
 /**
- * @brief Function to implement the Cellular Automata logic.
- * It should take a map and return the updated map after one iteration.
- * @param currentMap The map in its current state.
- * @param W Width of the map.
- * @param H Height of the map.
- * @param R Radius of the neighbor window (e.g., 1 for 3x3, 2 for 5x5).
- * @param U Threshold to decide if the current cell becomes 1 or 0.
- * @return The map after applying the cellular automata rules.
+ * @brief fillRect for a BitMap: one masked word OR per 64 cells of each row.
  */
-Map cellularAutomata(const Map& currentMap, int W, int H, int R, double U) {
-    Map newMap = currentMap; // Copia del mapa actual
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::mt19937 gen(seed);
-    std::uniform_real_distribution<> distProb(0.0, 1.0);
+inline void fillRect(BitMap& map, int startX, int endX, int startY, int endY) {
+    for (int x = startX; x <= endX; ++x) {
+        setBitSpan(map.row(x), startY, endY + 1);
+    }
+}
 
-    for (int i = 0; i < H; ++i) {
-        for (int j = 0; j < W; ++j) {
-            // Contar vecinos con valor 1 en la ventana de radio R
-            int countOnes = 0;
-            for (int di = -R; di <= R; ++di) {
-                for (int dj = -R; dj <= R; ++dj) {
-                    int ni = i + di;
-                    int nj = j + dj;
-                    if (ni >= 0 && ni < H && nj >= 0 && nj < W) {
-                        countOnes += currentMap[ni][nj];
-                    }
+/**
+ * @brief Carver writing 1s into anything indexable as map[i][j].
+ */
+template <typename MapT>
+struct MapCarver {
+    MapT& map;
+    void cell(int x, int y) { map[x][y] = 1; }
+    void rect(int startX, int endX, int startY, int endY) { fillRect(map, startX, endX, startY, endY); }
+};
+
+/**
+ * @brief Carver writing 1s into a BitMap.
+ */
+struct BitMapCarver {
+    BitMap& map;
+    void cell(int x, int y) { map.set(x, y, 1); }
+    void rect(int startX, int endX, int startY, int endY) { fillRect(map, startX, endX, startY, endY); }
+};
+
+/**
+ * @brief Carver that sets cells through an automaton's setCell.
+ * Lets the drunk agent carve into an ActiveRegionAutomaton or a
+ * CountingAutomaton, which then track the edits themselves.
+ */
+template <typename Automaton>
+struct AutomatonCarver {
+    Automaton& automaton;
+    void cell(int x, int y) { automaton.setCell(x, y, 1); }
+    void rect(int startX, int endX, int startY, int endY) {
+        for (int x = startX; x <= endX; ++x) {
+            for (int y = startY; y <= endY; ++y) {
+                automaton.setCell(x, y, 1);
+            }
+        }
+    }
+};
+
+/**
+ * @brief Inclusive rectangle of cells [startX, endX] x [startY, endY], as passed to carver.rect.
+ */
+struct CellRect {
+    int startX;
+    int endX;
+    int startY;
+    int endY;
+};
+
+/**
+ * @brief Union of rectangles as a list of disjoint rectangles (sweep line over rows).
+ * Rectangles are bucketed by startX with a counting sort, which is linear since
+ * rows are bounded. Each bucket is sorted by startY and its duplicates are
+ * dropped. The sweep then stops only at rows where some rectangle starts or
+ * ends. It keeps the active rectangles ordered by startY, merging each new
+ * bucket in, and merges their column intervals in one linear pass. Output
+ * rectangles stay open while the merged intervals do not change, so a stack of
+ * overlapping rooms becomes a few tall rectangles instead of one per slab.
+ * Overlapping area is covered exactly once.
+ * @param rects Rectangles to merge (empty ones, with start > end, are ignored).
+ * @return Disjoint rectangles covering the same cells.
+ */
+inline std::vector<CellRect> mergeRects(const std::vector<CellRect>& rects) {
+    int firstRow = 0;
+    int lastRow = -1; // Última fila ocupada por algún rectángulo
+    for (const CellRect& r : rects) {
+        if (r.startX <= r.endX && r.startY <= r.endY) {
+            firstRow = (lastRow < firstRow) ? r.startX : std::min(firstRow, r.startX);
+            lastRow = std::max(lastRow, r.endX);
+        }
+    }
+    std::vector<CellRect> merged;
+    if (lastRow < firstRow) {
+        return merged;
+    }
+
+    // Ordenación por cubetas de startX; endings[x] cuenta los que terminan en la fila x - 1
+    const std::size_t rows = static_cast<std::size_t>(lastRow - firstRow) + 2;
+    std::vector<int> bucketStart(rows + 1, 0);
+    std::vector<int> endings(rows, 0);
+    for (const CellRect& r : rects) {
+        if (r.startX <= r.endX && r.startY <= r.endY) {
+            ++bucketStart[static_cast<std::size_t>(r.startX - firstRow) + 1];
+        }
+    }
+    for (std::size_t x = 0; x < rows; ++x) {
+        bucketStart[x + 1] += bucketStart[x];
+    }
+    std::vector<CellRect> sorted(static_cast<std::size_t>(bucketStart[rows]));
+    {
+        std::vector<int> fill(bucketStart.begin(), bucketStart.end() - 1);
+        for (const CellRect& r : rects) {
+            if (r.startX <= r.endX && r.startY <= r.endY) {
+                sorted[static_cast<std::size_t>(fill[static_cast<std::size_t>(r.startX - firstRow)]++)] = r;
+            }
+        }
+    }
+    auto byStartY = [](const CellRect& a, const CellRect& b) { return a.startY < b.startY; };
+    for (std::size_t x = 0; x + 1 < rows; ++x) {
+        auto begin = sorted.begin() + bucketStart[x];
+        auto end = sorted.begin() + bucketStart[x + 1];
+        std::sort(begin, end, [](const CellRect& a, const CellRect& b) {
+            return std::tie(a.startY, a.endY, a.endX) < std::tie(b.startY, b.endY, b.endX);
+        });
+        auto last = std::unique(begin, end, [](const CellRect& a, const CellRect& b) {
+            return a.startY == b.startY && a.endY == b.endY && a.endX == b.endX;
+        });
+        // Marcar los duplicados como vacíos para saltarlos en el barrido
+        for (auto it = last; it != end; ++it) {
+            it->startY = 1;
+            it->endY = 0;
+        }
+        for (auto it = begin; it != last; ++it) {
+            ++endings[static_cast<std::size_t>(it->endX + 1 - firstRow)];
+        }
+    }
+
+    std::vector<CellRect> active; // Ordenados por startY
+    std::vector<CellRect> open;   // Intervalos del tramo actual, con su fila de inicio
+    std::vector<CellRect> spans;
+    for (std::size_t offset = 0; offset < rows; ++offset) {
+        const bool starts = bucketStart[offset] < bucketStart[offset + 1];
+        if (!starts && endings[offset] == 0) {
+            continue; // Nada empieza ni termina en esta fila
+        }
+        const int x = firstRow + static_cast<int>(offset);
+        if (endings[offset] > 0) {
+            active.erase(std::remove_if(active.begin(), active.end(), [x](const CellRect& r) { return r.endX < x; }),
+                         active.end());
+        }
+        if (starts) {
+            const std::size_t oldActive = active.size();
+            for (int k = bucketStart[offset]; k < bucketStart[offset + 1]; ++k) {
+                if (sorted[static_cast<std::size_t>(k)].startY <= sorted[static_cast<std::size_t>(k)].endY) {
+                    active.push_back(sorted[static_cast<std::size_t>(k)]);
                 }
             }
-            // Aplicar regla
-            double neighborRatio = static_cast<double>(countOnes) / ((2 * R + 1) * (2 * R + 1));
-            newMap[i][j] = (neighborRatio > U) ? 1 : 0;
+            std::inplace_merge(active.begin(), active.begin() + static_cast<std::ptrdiff_t>(oldActive), active.end(),
+                               byStartY);
+        }
+
+        // Unir intervalos de columnas que se solapan o se tocan
+        spans.clear();
+        for (const CellRect& r : active) {
+            if (!spans.empty() && r.startY <= spans.back().endY + 1) {
+                spans.back().endY = std::max(spans.back().endY, r.endY);
+            } else {
+                spans.push_back({x, 0, r.startY, r.endY});
+            }
+        }
+
+        bool unchanged = (spans.size() == open.size());
+        for (std::size_t k = 0; unchanged && k < spans.size(); ++k) {
+            unchanged = (spans[k].startY == open[k].startY && spans[k].endY == open[k].endY);
+        }
+        if (!unchanged) {
+            for (CellRect& r : open) {
+                r.endX = x - 1;
+                merged.push_back(r);
+            }
+            open.swap(spans);
         }
     }
+    return merged;
+}
 
-    return newMap;
+/**
+ * @brief Record of the cells a drunk agent carved during one call.
+ * Rooms are stored as they are stamped. Consecutive corridor cells along a
+ * row or a column are coalesced into one thin rectangle, so a straight run
+ * costs one entry. The bounding box of everything recorded is kept up to date.
+ * Rectangles may overlap (compact() makes them disjoint). Downstream stages
+ * (cellular automata, rendering, serialization) can restrict their work to
+ * these rectangles instead of the whole map.
+ */
+struct CarveLog {
+    std::vector<CellRect> rects;
+    CellRect bounds{0, -1, 0, -1}; // Vacío mientras startX > endX
+
+    bool empty() const { return rects.empty(); }
+
+    /**
+     * @brief Total area of the recorded rectangles (overlaps counted more than once).
+     */
+    long long area() const {
+        long long total = 0;
+        for (const CellRect& r : rects) {
+            total += static_cast<long long>(r.endX - r.startX + 1) * (r.endY - r.startY + 1);
+        }
+        return total;
+    }
+
+    void clear() {
+        rects.clear();
+        bounds = {0, -1, 0, -1};
+    }
+
+    void addRect(int startX, int endX, int startY, int endY) {
+        if (startX > endX || startY > endY) {
+            return;
+        }
+        rects.push_back({startX, endX, startY, endY});
+        extendBounds(startX, endX, startY, endY);
+    }
+
+    void addCell(int x, int y) {
+        if (!rects.empty()) {
+            CellRect& last = rects.back();
+            // Extender el último tramo si la celda lo continúa en su fila o columna
+            if (last.startX == x && last.endX == x && (y == last.endY + 1 || y == last.startY - 1)) {
+                last.startY = std::min(last.startY, y);
+                last.endY = std::max(last.endY, y);
+                extendBounds(x, x, y, y);
+                return;
+            }
+            if (last.startY == y && last.endY == y && (x == last.endX + 1 || x == last.startX - 1)) {
+                last.startX = std::min(last.startX, x);
+                last.endX = std::max(last.endX, x);
+                extendBounds(x, x, y, y);
+                return;
+            }
+            if (last.startX <= x && x <= last.endX && last.startY <= y && y <= last.endY) {
+                return; // Ya registrada
+            }
+        }
+        addRect(x, x, y, y);
+    }
+
+    /**
+     * @brief Replaces the rectangles by their disjoint union (see mergeRects).
+     */
+    void compact() { rects = mergeRects(rects); }
+
+    /**
+     * @brief Bounding box grown by R cells on every side and clipped to the map.
+     * Every cell whose window of radius R touches a carved cell lies inside it.
+     * @return An empty rectangle (startX > endX) if nothing was carved.
+     */
+    CellRect dirtyRegion(int R, int W, int H) const {
+        if (empty()) {
+            return bounds;
+        }
+        return {std::max(0, bounds.startX - R), std::min(H - 1, bounds.endX + R),
+                std::max(0, bounds.startY - R), std::min(W - 1, bounds.endY + R)};
+    }
+
+private:
+    void extendBounds(int startX, int endX, int startY, int endY) {
+        if (bounds.startX > bounds.endX) {
+            bounds = {startX, endX, startY, endY};
+            return;
+        }
+        bounds.startX = std::min(bounds.startX, startX);
+        bounds.endX = std::max(bounds.endX, endX);
+        bounds.startY = std::min(bounds.startY, startY);
+        bounds.endY = std::max(bounds.endY, endY);
+    }
+};
+
+/**
+ * @brief Carver decorator that forwards to an inner carver and records everything in a CarveLog.
+ */
+template <typename Inner>
+struct LoggingCarver {
+    Inner& inner;
+    CarveLog& log;
+
+    void cell(int x, int y) {
+        inner.cell(x, y);
+        log.addCell(x, y);
+    }
+    void rect(int startX, int endX, int startY, int endY) {
+        inner.rect(startX, endX, startY, endY);
+        log.addRect(startX, endX, startY, endY);
+    }
+};
+
+/**
+ * @brief Carver decorator that defers rooms and writes their union once.
+ * Corridor cells go straight to the inner carver, and so do rooms smaller
+ * than minBatchArea. Larger rooms are only recorded, and flush() merges them
+ * with mergeRects and passes the disjoint result to inner.rect. Since carving
+ * only sets cells to 1, the final map is the same as stamping every room as
+ * it comes.
+ * The threshold is the area where batching stops losing to direct stamping.
+ */
+template <typename Inner>
+struct RoomBatchCarver {
+    Inner& inner;
+    std::vector<CellRect> rooms;
+    long long minBatchArea = 169; // 13x13: habitaciones menores se escriben directamente
+
+    void cell(int x, int y) { inner.cell(x, y); }
+    void rect(int startX, int endX, int startY, int endY) {
+        if (static_cast<long long>(endX - startX + 1) * (endY - startY + 1) < minBatchArea) {
+            inner.rect(startX, endX, startY, endY);
+        } else {
+            rooms.push_back({startX, endX, startY, endY});
+        }
+    }
+
+    /**
+     * @brief Rasterizes the union of the recorded rooms and clears them.
+     */
+    void flush() {
+        for (const CellRect& r : mergeRects(rooms)) {
+            inner.rect(r.startX, r.endX, r.startY, r.endY);
+        }
+        rooms.clear();
+    }
+};
+
+/**
+ * @brief Drunk Agent that carves directly into a caller-owned map, using the given generator.
+ * The agent only ever sets cells to 1, so working in place gives the same
+ * result as drunkAgent without copying the map or allocating. Passing a
+ * seeded generator makes the carved cells reproducible.
+ * Parameters are the same as in drunkAgent.
+ * @param map The map to carve (updated in place).
+ * @param gen Random number generator driving the agent (e.g. a seeded Xoshiro256StarStar).
+ */
+template <typename MapT, typename Rng>
+void drunkAgentInPlace(MapT& map, int W, int H, int J, int I, int roomSizeX, int roomSizeY,
+                       double probGenerateRoom, double probIncreaseRoom,
+                       double probChangeDirection, double probIncreaseChange,
+                       int& agentX, int& agentY, Rng& gen) {
+    MapCarver<MapT> carver{map};
+    drunkAgentWalk(carver, W, H, J, I, roomSizeX, roomSizeY,
+                   probGenerateRoom, probIncreaseRoom,
+                   probChangeDirection, probIncreaseChange,
+                   agentX, agentY, gen);
+}
+
+/**
+ * @brief drunkAgentInPlace with rooms batched through RoomBatchCarver.
+ * Produces exactly the same map as drunkAgentInPlace with the same generator
+ * state, but overlapping rooms of at least RoomBatchCarver::minBatchArea
+ * cells are merged first so each cell of their union is written once. This
+ * pays off on dense walks with large rooms; with small rooms it costs about
+ * the same as drunkAgentInPlace. Parameters are the same as in drunkAgent.
+ * @param map The map to carve (updated in place).
+ * @param gen Random number generator driving the agent.
+ */
+template <typename MapT, typename Rng>
+void drunkAgentBatchedInPlace(MapT& map, int W, int H, int J, int I, int roomSizeX, int roomSizeY,
+                              double probGenerateRoom, double probIncreaseRoom,
+                              double probChangeDirection, double probIncreaseChange,
+                              int& agentX, int& agentY, Rng& gen) {
+    MapCarver<MapT> mapCarver{map};
+    RoomBatchCarver<MapCarver<MapT>> carver{mapCarver, {}};
+    drunkAgentWalk(carver, W, H, J, I, roomSizeX, roomSizeY,
+                   probGenerateRoom, probIncreaseRoom,
+                   probChangeDirection, probIncreaseChange,
+                   agentX, agentY, gen);
+    carver.flush();
+}
+
+/**
+ * @brief drunkAgentInPlace using the event-driven drunkAgentWalkSkipping.
+ * Better suited to walks with large I, where most steps are neither rooms
+ * nor turns. Parameters are the same as in drunkAgent.
+ * @param map The map to carve (updated in place).
+ * @param gen Random number generator driving the agent.
+ */
+template <typename MapT, typename Rng>
+void drunkAgentSkipInPlace(MapT& map, int W, int H, int J, int I, int roomSizeX, int roomSizeY,
+                           double probGenerateRoom, double probIncreaseRoom,
+                           double probChangeDirection, double probIncreaseChange,
+                           int& agentX, int& agentY, Rng& gen) {
+    MapCarver<MapT> carver{map};
+    drunkAgentWalkSkipping(carver, W, H, J, I, roomSizeX, roomSizeY,
+                           probGenerateRoom, probIncreaseRoom,
+                           probChangeDirection, probIncreaseChange,
+                           agentX, agentY, gen);
+}
+
+/**
+ * @brief drunkAgentInPlace that also reports what it carved.
+ * Carves exactly the same cells as drunkAgentInPlace with the same generator
+ * state. The log is cleared first.
+ * Parameters are the same as in drunkAgent.
+ * @param map The map to carve (updated in place).
+ * @param gen Random number generator driving the agent.
+ * @param log Receives the carved spans and rooms and their bounding box.
+ */
+template <typename MapT, typename Rng>
+void drunkAgentInPlace(MapT& map, int W, int H, int J, int I, int roomSizeX, int roomSizeY,
+                       double probGenerateRoom, double probIncreaseRoom,
+                       double probChangeDirection, double probIncreaseChange,
+                       int& agentX, int& agentY, Rng& gen, CarveLog& log) {
+    log.clear();
+    MapCarver<MapT> mapCarver{map};
+    LoggingCarver<MapCarver<MapT>> carver{mapCarver, log};
+    drunkAgentWalk(carver, W, H, J, I, roomSizeX, roomSizeY,
+                   probGenerateRoom, probIncreaseRoom,
+                   probChangeDirection, probIncreaseChange,
+                   agentX, agentY, gen);
+}
+
+/**
+ * @brief Drunk Agent that carves directly into a caller-owned map.
+ * Same as the overload above with a generator seeded from the clock, so
+ * results are not reproducible.
+ * @param map The map to carve (updated in place).
+ */
+template <typename MapT>
+void drunkAgentInPlace(MapT& map, int W, int H, int J, int I, int roomSizeX, int roomSizeY,
+                       double probGenerateRoom, double probIncreaseRoom,
+                       double probChangeDirection, double probIncreaseChange,
+                       int& agentX, int& agentY) {
+    Xoshiro256StarStar gen(clockSeed());
+    drunkAgentInPlace(map, W, H, J, I, roomSizeX, roomSizeY,
+                      probGenerateRoom, probIncreaseRoom,
+                      probChangeDirection, probIncreaseChange,
+                      agentX, agentY, gen);
 }
 
 /**
@@ -77,80 +3422,400 @@ Map cellularAutomata(const Map& currentMap, int W, int H, int R, double U) {
  * @param probIncreaseChange If direction is not changed, this value increases probChangeDirection.
  * @param agentX Current X position of the agent (updated by reference).
  * @param agentY Current Y position of the agent (updated by reference).
+ * Works on a Map or on a Grid (anything indexable as map[i][j]).
  * @return The map after the agent's movements and actions.
  */
-Map drunkAgent(Map& currentMap, int W, int H, int J, int I, int roomSizeX, int roomSizeY,
-               double probGenerateRoom, double probIncreaseRoom,
-               double probChangeDirection, double probIncreaseChange,
-               int& agentX, int& agentY) {
-    Map newMap = currentMap;
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::mt19937 gen(seed);
-    std::uniform_int_distribution<> distDirection(0, 3);
-    std::uniform_real_distribution<> distProb(0.0, 1.0);
+template <typename MapT>
+MapT drunkAgent(MapT& currentMap, int W, int H, int J, int I, int roomSizeX, int roomSizeY,
+                double probGenerateRoom, double probIncreaseRoom,
+                double probChangeDirection, double probIncreaseChange,
+                int& agentX, int& agentY) {
+    MapT newMap = currentMap;
+    drunkAgentInPlace(newMap, W, H, J, I, roomSizeX, roomSizeY,
+                      probGenerateRoom, probIncreaseRoom,
+                      probChangeDirection, probIncreaseChange,
+                      agentX, agentY);
+    return newMap;
+}
 
-    std::vector<std::pair<int, int>> directions = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
-    double currentProbRoom = probGenerateRoom;
-    double currentProbChange = probChangeDirection; // Probabilidad actual para cambiar dirección
+/**
+ * @brief drunkAgent that also reports the carved region in log (see CarveLog).
+ * @param log Receives the carved spans and rooms and their bounding box.
+ * @return The map after the agent's movements and actions.
+ */
+template <typename MapT>
+MapT drunkAgent(MapT& currentMap, int W, int H, int J, int I, int roomSizeX, int roomSizeY,
+                double probGenerateRoom, double probIncreaseRoom,
+                double probChangeDirection, double probIncreaseChange,
+                int& agentX, int& agentY, CarveLog& log) {
+    MapT newMap = currentMap;
+    Xoshiro256StarStar gen(clockSeed());
+    drunkAgentInPlace(newMap, W, H, J, I, roomSizeX, roomSizeY,
+                      probGenerateRoom, probIncreaseRoom,
+                      probChangeDirection, probIncreaseChange,
+                      agentX, agentY, gen, log);
+    return newMap;
+}
 
-    for (int walk = 0; walk < J; ++walk) {
-        int currentDirection = distDirection(gen);
-        for (int step = 0; step < I; ++step) {
-            // Marcar la posición actual como pasillo (1)
-            newMap[agentX][agentY] = 1;
+/**
+ * @brief cellularAutomataIncremental after a drunk agent call, reusing buffers.
+ * The changed cells are every cell recorded in log plus the flips of the
+ * previous step (empty if the map was stable before the agent ran).
+ * @param log What the agent carved since the previous step.
+ * @param flips In: cells flipped by the previous step. Out: cells flipped by this one.
+ * @param buffers Scratch storage.
+ */
+template <typename MapT>
+void cellularAutomataIncremental(MapT& map, int W, int H, int R, double U, const CarveLog& log,
+                                 std::vector<std::pair<int, int>>& flips, IncrementalBuffers& buffers) {
+    std::vector<std::pair<int, int>>& changed = buffers.changed;
+    changed.assign(flips.begin(), flips.end());
+    for (const CellRect& r : log.rects) {
+        for (int x = r.startX; x <= r.endX; ++x) {
+            for (int y = r.startY; y <= r.endY; ++y) {
+                changed.emplace_back(x, y);
+            }
+        }
+    }
+    cellularAutomataIncremental(map, W, H, R, U, changed, flips, buffers);
+}
 
-            // Generar habitación
-            if (distProb(gen) < currentProbRoom) {
-                int halfX = roomSizeX / 2;
-                int halfY = roomSizeY / 2;
-                int startX = std::max(0, agentX - halfX);
-                int endX = std::min(H - 1, agentX + halfX);
-                int startY = std::max(0, agentY - halfY);
-                int endY = std::min(W - 1, agentY + halfY);
-                for (int x = startX; x <= endX; ++x) {
-                    for (int y = startY; y <= endY; ++y) {
-                        newMap[x][y] = 1;
-                    }
-                }
-                currentProbRoom = probGenerateRoom;
-            } else {
-                currentProbRoom += probIncreaseRoom;
+/**
+ * @brief cellularAutomataIncremental after a drunk agent call.
+ * @param log What the agent carved since the previous step.
+ * @param previousFlips Cells flipped by the previous incremental step.
+ * @return (row, column) of the cells that flipped in this step.
+ */
+template <typename MapT>
+std::vector<std::pair<int, int>> cellularAutomataIncremental(MapT& map, int W, int H, int R, double U,
+                                                             const CarveLog& log,
+                                                             const std::vector<std::pair<int, int>>& previousFlips = {}) {
+    IncrementalBuffers buffers;
+    std::vector<std::pair<int, int>> flips = previousFlips;
+    cellularAutomataIncremental(map, W, H, R, U, log, flips, buffers);
+    return flips;
+}
+
+/**
+ * @brief Parameters of one drunkAgent call (see drunkAgent for their meaning).
+ */
+struct DrunkAgentParams {
+    int J = 5;
+    int I = 10;
+    int roomSizeX = 5;
+    int roomSizeY = 3;
+    double probGenerateRoom = 0.15;
+    double probIncreaseRoom = 0.05;
+    double probChangeDirection = 0.15;
+    double probIncreaseChange = 0.05;
+};
+
+/**
+ * @brief Mixes a seed with extra values into a new 64-bit seed (splitmix64 finalizer).
+ */
+std::uint64_t mixSeed(std::uint64_t seed, std::uint64_t a, std::uint64_t b = 0, std::uint64_t c = 0) {
+    std::uint64_t h = seed;
+    for (std::uint64_t v : {a, b, c}) {
+        h += 0x9e3779b97f4a7c15ULL + v;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+/**
+ * @brief Unbounded world generated on demand in fixed-size square chunks.
+ * Everything is a pure function of the world seed and global coordinates:
+ * the initial noise is hashed per cell, and every chunk owns one drunk agent
+ * confined to the chunk plus agentMargin cells, seeded by its chunk
+ * coordinates and the iteration. To build a region, the noise is generated
+ * with an R * iterations halo, and each iteration runs the CA and then
+ * replays every agent whose territory reaches the region. Errors from the
+ * halo's cut edges move inward only R cells per iteration, so they never reach
+ * the region itself, and neighboring chunks agree on their seams. Recently used
+ * chunks are kept in an LRU cache of bounded size.
+ */
+class ChunkWorld {
+public:
+    struct Settings {
+        int chunkSize = 64;
+        int iterations = 3;            // Pasadas de autómata + agente, como en main
+        int R = 1;
+        double U = 0.5;
+        double fillProbability = 0.5;  // Probabilidad inicial de que una celda sea 1
+        int agentMargin = 16;          // Cuánto puede salir el agente de su chunk
+        DrunkAgentParams agent;
+        std::size_t cacheCapacity = 64;
+    };
+
+    ChunkWorld(std::uint64_t seed, const Settings& settings) : seed_(seed), settings_(settings) {
+        settings_.chunkSize = std::max(1, settings_.chunkSize);
+        settings_.cacheCapacity = std::max<std::size_t>(1, settings_.cacheCapacity);
+    }
+
+    /**
+     * @brief Returns chunk (chunkRow, chunkCol), generating it if it is not cached.
+     * The reference stays valid until a later call evicts the chunk.
+     */
+    const Map& chunk(long long chunkRow, long long chunkCol) {
+        const ChunkKey key{chunkRow, chunkCol};
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->second;
+        }
+        const int C = settings_.chunkSize;
+        lru_.emplace_front(key, region(chunkRow * C, chunkCol * C, C, C));
+        index_[key] = lru_.begin();
+        if (lru_.size() > settings_.cacheCapacity) {
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+        return lru_.front().second;
+    }
+
+    /**
+     * @brief Value of one cell of the world (through the chunk cache).
+     */
+    int cell(long long row, long long col) {
+        const long long C = settings_.chunkSize;
+        const long long chunkRow = floorDiv(row, C);
+        const long long chunkCol = floorDiv(col, C);
+        return chunk(chunkRow, chunkCol)[row - chunkRow * C][col - chunkCol * C];
+    }
+
+    std::size_t cachedChunks() const { return lru_.size(); }
+
+    /**
+     * @brief Generates an arbitrary rectangle of the world, bypassing the cache.
+     * @param row0 Global row of the top-left cell.
+     * @param col0 Global column of the top-left cell.
+     * @param rows Height of the rectangle.
+     * @param cols Width of the rectangle.
+     * @return The generated cells.
+     */
+    Map region(long long row0, long long col0, int rows, int cols) const {
+        const Settings& s = settings_;
+        const int halo = s.R * s.iterations;
+        const int paddedH = rows + 2 * halo;
+        const int paddedW = cols + 2 * halo;
+        const long long top = row0 - halo;
+        const long long left = col0 - halo;
+
+        Map front(paddedH, std::vector<int>(paddedW, 0));
+        for (int i = 0; i < paddedH; ++i) {
+            for (int j = 0; j < paddedW; ++j) {
+                const std::uint64_t h = mixSeed(seed_, static_cast<std::uint64_t>(top + i),
+                                                static_cast<std::uint64_t>(left + j));
+                front[i][j] = (static_cast<double>(h >> 11) * 0x1.0p-53 < s.fillProbability) ? 1 : 0;
             }
+        }
+        Map back = front;
 
-            // Decidir si cambiar de dirección
-            if (distProb(gen) < currentProbChange) {
-                currentDirection = distDirection(gen);
-                currentProbChange = probChangeDirection; // Reiniciar probabilidad
-            } else {
-                currentProbChange += probIncreaseChange; // Aumentar probabilidad
+        // Agentes cuyo territorio (chunk + margen) toca la región con halo
+        const long long C = s.chunkSize;
+        const long long M = s.agentMargin;
+        const int territory = static_cast<int>(C + 2 * M);
+        struct Agent {
+            long long chunkRow, chunkCol;
+            int x, y;
+        };
+        std::vector<Agent> agents;
+        for (long long cr = floorDiv(top - M, C); cr <= floorDiv(top + paddedH - 1 + M, C); ++cr) {
+            for (long long cc = floorDiv(left - M, C); cc <= floorDiv(left + paddedW - 1 + M, C); ++cc) {
+                agents.push_back({cr, cc, territory / 2, territory / 2});
             }
+        }
+        Map carve(territory, std::vector<int>(territory, 0));
 
-            // Calcular el siguiente movimiento
-            int dx = directions[currentDirection].first;
-            int dy = directions[currentDirection].second;
-            int nextX = agentX + dx;
-            int nextY = agentY + dy;
+        for (int t = 0; t < s.iterations; ++t) {
+            cellularAutomataInto(front, back, paddedW, paddedH, s.R, s.U);
+            front.swap(back);
 
-            // Verificar límites
-            if (nextX >= 0 && nextX < H && nextY >= 0 && nextY < W) {
-                agentX = nextX;
-                agentY = nextY;
-            } else {
-                currentDirection = distDirection(gen);
-                currentProbChange = probChangeDirection; // Reiniciar probabilidad al chocar con el borde
+            for (Agent& agent : agents) {
+                for (auto& row : carve) {
+                    std::fill(row.begin(), row.end(), 0);
+                }
+                Xoshiro256StarStar gen(mixSeed(seed_ ^ 0xa5a5a5a5a5a5a5a5ULL, static_cast<std::uint64_t>(agent.chunkRow),
+                                               static_cast<std::uint64_t>(agent.chunkCol), static_cast<std::uint64_t>(t)));
+                drunkAgentInPlace(carve, territory, territory, s.agent.J, s.agent.I,
+                                  s.agent.roomSizeX, s.agent.roomSizeY,
+                                  s.agent.probGenerateRoom, s.agent.probIncreaseRoom,
+                                  s.agent.probChangeDirection, s.agent.probIncreaseChange,
+                                  agent.x, agent.y, gen);
+
+                // Copiar lo excavado sobre la región, en coordenadas globales
+                const long long carveTop = agent.chunkRow * C - M;
+                const long long carveLeft = agent.chunkCol * C - M;
+                const int i0 = static_cast<int>(std::max(0LL, carveTop - top));
+                const int i1 = static_cast<int>(std::min<long long>(paddedH, carveTop + territory - top));
+                const int j0 = static_cast<int>(std::max(0LL, carveLeft - left));
+                const int j1 = static_cast<int>(std::min<long long>(paddedW, carveLeft + territory - left));
+                for (int i = i0; i < i1; ++i) {
+                    const std::vector<int>& src = carve[i + top - carveTop];
+                    for (int j = j0; j < j1; ++j) {
+                        front[i][j] |= src[j + left - carveLeft];
+                    }
+                }
             }
         }
+
+        Map out(rows, std::vector<int>(cols, 0));
+        for (int i = 0; i < rows; ++i) {
+            std::copy(front[i + halo].begin() + halo, front[i + halo].begin() + halo + cols, out[i].begin());
+        }
+        return out;
     }
 
-    return newMap;
+private:
+    using ChunkKey = std::pair<long long, long long>;
+
+    struct ChunkKeyHash {
+        std::size_t operator()(const ChunkKey& k) const {
+            return static_cast<std::size_t>(mixSeed(0, static_cast<std::uint64_t>(k.first),
+                                                    static_cast<std::uint64_t>(k.second)));
+        }
+    };
+
+    static long long floorDiv(long long a, long long b) {
+        return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+    }
+
+    std::uint64_t seed_;
+    Settings settings_;
+    std::list<std::pair<ChunkKey, Map>> lru_; // Más reciente al frente
+    std::unordered_map<ChunkKey, std::list<std::pair<ChunkKey, Map>>::iterator, ChunkKeyHash> index_;
+};
+
+/**
+ * @brief Bit-packed map whose cells can be set concurrently from many threads.
+ * Same layout as BitMap; every write is an atomic fetch_or on its word, so
+ * agents carving the same word never lose each other's bits.
+ */
+class AtomicBitMap {
+public:
+    AtomicBitMap(int W, int H)
+        : W_(W), H_(H), wordsPerRow_((W + 63) / 64),
+          words_(new std::atomic<std::uint64_t>[static_cast<std::size_t>(H) * ((W + 63) / 64)]) {
+        for (std::size_t k = 0; k < wordCount(); ++k) {
+            words_[k].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    explicit AtomicBitMap(const BitMap& bits) : AtomicBitMap(bits.W, bits.H) {
+        for (std::size_t k = 0; k < wordCount(); ++k) {
+            words_[k].store(bits.words[k], std::memory_order_relaxed);
+        }
+    }
+
+    int width() const { return W_; }
+    int height() const { return H_; }
+
+    void set(int i, int j) {
+        words_[static_cast<std::size_t>(i) * wordsPerRow_ + (j >> 6)].fetch_or(
+            std::uint64_t{1} << (j & 63), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Sets columns [begin, end) of row i with one atomic OR per word.
+     */
+    void setSpan(int i, int begin, int end) {
+        std::atomic<std::uint64_t>* row = &words_[static_cast<std::size_t>(i) * wordsPerRow_];
+        for (int k = begin >> 6; begin < end; ++k) {
+            const int wordEnd = std::min(end, (k + 1) * 64);
+            row[k].fetch_or(bitSpanMask(begin & 63, wordEnd - k * 64), std::memory_order_relaxed);
+            begin = wordEnd;
+        }
+    }
+
+    /**
+     * @brief Snapshot as a plain BitMap (call once the writers are done).
+     */
+    BitMap toBitMap() const {
+        BitMap bits(W_, H_);
+        for (std::size_t k = 0; k < wordCount(); ++k) {
+            bits.words[k] = words_[k].load(std::memory_order_relaxed);
+        }
+        return bits;
+    }
+
+private:
+    std::size_t wordCount() const { return static_cast<std::size_t>(H_) * wordsPerRow_; }
+
+    int W_;
+    int H_;
+    int wordsPerRow_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> words_;
+};
+
+/**
+ * @brief Carver writing into an AtomicBitMap; safe to use from several threads.
+ */
+struct AtomicBitCarver {
+    AtomicBitMap& map;
+    void cell(int x, int y) { map.set(x, y); }
+    void rect(int startX, int endX, int startY, int endY) {
+        for (int x = startX; x <= endX; ++x) {
+            map.setSpan(x, startY, endY + 1);
+        }
+    }
+};
+
+/**
+ * @brief Position of one drunk agent.
+ */
+struct AgentState {
+    int x;
+    int y;
+};
+
+/**
+ * @brief Runs many drunk agents concurrently on one packed map.
+ * Agent k walks with its own generator seeded from (seed, k) and carves with
+ * atomic bit-ORs. Carving only ever sets bits, so the final map and the agent
+ * positions are the same for any thread count or scheduling.
+ * @param map The packed map to carve.
+ * @param agents Agent positions (updated).
+ * @param params Drunk agent parameters shared by all agents.
+ * @param seed Base seed for the agents' generators.
+ * @param pool Thread pool that runs the agents.
+ * @tparam Rng Generator type, constructed from a 64-bit seed.
+ */
+template <typename Rng = Xoshiro256StarStar>
+void drunkAgentsParallel(AtomicBitMap& map, std::vector<AgentState>& agents, const DrunkAgentParams& params,
+                         std::uint64_t seed, ThreadPool& pool) {
+    pool.parallelFor(static_cast<int>(agents.size()), [&](int k) {
+        AtomicBitCarver carver{map};
+        Rng gen(mixSeed(seed, static_cast<std::uint64_t>(k)));
+        drunkAgentWalk(carver, map.width(), map.height(), params.J, params.I,
+                       params.roomSizeX, params.roomSizeY,
+                       params.probGenerateRoom, params.probIncreaseRoom,
+                       params.probChangeDirection, params.probIncreaseChange,
+                       agents[k].x, agents[k].y, gen);
+    });
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     std::cout << "--- CELLULAR AUTOMATA AND DRUNK AGENT SIMULATION ---" << std::endl;
 
-    // Configurar generador de números aleatorios
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::mt19937 gen(seed);
+    // Configurar generador de números aleatorios: semilla explícita (argv[1]) o del reloj
+    std::uint64_t seed = clockSeed();
+    if (argc > 1) {
+        const char* text = argv[1];
+        char* end = nullptr;
+        errno = 0;
+        const unsigned long long parsed = std::strtoull(text, &end, 10);
+        // strtoull acepta signos y espacios iniciales: exigir solo dígitos decimales
+        if (text[0] < '0' || text[0] > '9' || *end != '\0' || errno == ERANGE) {
+            std::cerr << "Semilla no válida: '" << text << "'" << std::endl;
+            std::cerr << "Uso: " << argv[0] << " [semilla entera sin signo de 64 bits]" << std::endl;
+            return 1;
+        }
+        seed = static_cast<std::uint64_t>(parsed);
+    }
+    std::cout << "Semilla: " << seed << std::endl;
+    Xoshiro256StarStar gen(seed);
     std::uniform_int_distribution<> dist01(0, 1);
     std::uniform_int_distribution<> distJ(3, 7); // Rango para J
     std::uniform_int_distribution<> distI(5, 15); // Rango para I
@@ -187,6 +3852,15 @@ int main() {
     int ca_R = 1;
     double ca_U = 0.5;
 
+    // Buffer de respaldo: se reserva una sola vez y se intercambia con myMap
+    Map backMap = myMap;
+    // Celdas cambiadas por el último paso del autómata y lo tallado después por el agente:
+    // si son pocas, el siguiente paso solo reevalúa su vecindad (buffers reutilizados)
+    std::vector<std::pair<int, int>> caFlips;
+    IncrementalBuffers caBuffers;
+    CarveLog carveLog;
+    const long long caWindow = static_cast<long long>(2 * ca_R + 1) * (2 * ca_R + 1);
+
     // --- Main Simulation Loop ---
     for (int iteration = 0; iteration < numIterations; ++iteration) {
         std::cout << "\n--- Iteration " << iteration + 1 << " ---" << std::endl;
@@ -208,13 +3882,25 @@ int main() {
                   << std::endl;
 
         // Ejecutar simulaciones
-        myMap = cellularAutomata(myMap, ca_W, ca_H, ca_R, ca_U);
-        myMap = drunkAgent(myMap, ca_W, ca_H, da_J, da_I, da_roomSizeX, da_roomSizeY,
-                           da_probGenerateRoom, da_probIncreaseRoom,
-                           da_probChangeDirection, da_probIncreaseChange,
-                           drunkAgentX, drunkAgentY);
+        long long caFlipped = 0;
+        const long long pendingChanges = static_cast<long long>(caFlips.size()) + carveLog.area();
+        if (iteration > 0 && pendingChanges * caWindow < static_cast<long long>(ca_W) * ca_H) {
+            cellularAutomataIncremental(myMap, ca_W, ca_H, ca_R, ca_U, carveLog, caFlips, caBuffers);
+            caFlipped = static_cast<long long>(caFlips.size());
+        } else {
+            StepStats caStats = cellularAutomataStats(myMap, backMap, ca_W, ca_H, ca_R, ca_U);
+            caFlips.clear();
+            appendChangedCells(myMap, backMap, ca_W, ca_H, caFlips);
+            myMap.swap(backMap);
+            caFlipped = caStats.flipped;
+        }
+        drunkAgentInPlace(myMap, ca_W, ca_H, da_J, da_I, da_roomSizeX, da_roomSizeY,
+                          da_probGenerateRoom, da_probIncreaseRoom,
+                          da_probChangeDirection, da_probIncreaseChange,
+                          drunkAgentX, drunkAgentY, gen, carveLog);
 
         printMap(myMap);
+        std::cout << "Celdas cambiadas por el autómata: " << caFlipped << std::endl;
     }
 
     std::cout << "\n--- Simulation Finished ---" << std::endl;